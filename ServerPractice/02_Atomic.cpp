@@ -13,6 +13,7 @@
 	1 >> 2 >> 1 >> 3 >> 2 >> 3 의 순서로 일어난다면 결과값은 2가 아닌 1이 증가되고 끝나게 된다.
 	이런 문제를 보완하기 위해서는 1 >> 2 >> 3 을 하나로 묶어서 연산을 한번 하면 무조건 세단계가 진행되게 하는 것이다.
 	이런 기능을 지원하는 것이 atomic 클래스이다.
+	(여러 스레드가 atomic 하나를 계속 올리면 캐시라인을 두고 싸우게 된다. 나눠서 세는 방법은 ShardedCounter.h, 44_ShardedCounter 참고)
 */
 
 #include <iostream>
@@ -6,6 +6,7 @@
 	그렇게 되면 다른 스레드들은 문이 잠겨있기 때문에 공통 변수가 있는 방에서 작업을 할 수가 없고 기다려야 한다.
 	단, 주의해야 할 것은 문을 잠궜으면 "반드시" 문을 열어야 한다.
 	그렇지 않으면 다른 스레드들은 문이 열릴때 까지 무한정 기다릴것이고 이를 Deadlock이라 한다.
+	(lock_guard 자리마다 얼마나 기다렸는지 재보는 방법은 LockProfiler.h, 43_LockProfiler 참고)
 */
 
 #include<iostream>
@@ -1,6 +1,7 @@
 /*
 	Lock을 사용한다는건 사용할 수 있는 조건이 될 때까지 기다리는 것이다.
 	Spin Lock은 내가 공통 변수를 사용할 수 있는 조건이 될때까지 무작정 기다리는 것이다.
+	(pause로 쉬어가며 잠깐만 돌고 안되면 잠드는 AdaptiveLock은 Lock.h, 41_AdaptiveLock 참고)
 */
 
 #include <iostream>
@@ -7,6 +7,7 @@
 	스케쥴링 : A프로세스(스레드)에 자원을 할당한 후 다음에는 어느 프로세스(스레드)에 자원을 할당해야 하는지 결정. 스케쥴링을 하는 방법은 운영체제마다, 정책마다 다르다.
 	커널에선 각 프로세스에게 정해진 시간만큼 자원을 사용할 수 있는 권한을 주고 프로세스는 주어진 시간이 끝나거나 더 이상 할 작업이 없다면 권한을 커널에 돌려주게 된다.
 	이 방식이 자격증 공부할때 항상 나오던 "시분할 시스템"인듯 하다.
+	(정해진 시간만큼 자는 대신 lock이 풀리면 바로 깨워주는 AdaptiveLock은 Lock.h, 41_AdaptiveLock 참고)
 */
 
 #include <iostream>
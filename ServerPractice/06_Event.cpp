@@ -11,6 +11,7 @@
 	3. 그 신호를 받은 커널은 B에게 달려가 "아까 쓰던 놈 다 썼으니까 빨리 가서 써."하는 신호를 준다.
 	Event 방식의 장점은 스핀락처럼 무식하게 계속 기다리지도 않고 Sleep처럼 운에 맡기면서 쉬지도 않으니 효율적인 처리가 가능하다는 점이다.
 	하지만 단점이라고 한다면 또 다른 중재자가 필요한 셈이니 추가적인 리소스를 사용하게 된다는 것이다. 그렇기 때문에 아무때나 쓸 수 있는 것은 아니고 꼭 필요할 때만 써야 한다.
+	(스레드를 재우지 않고 코루틴만 기다리게 하는 버전은 Coroutine.h의 AsyncEvent, 40_Coroutine 참고)
 */
 
 #include <iostream>
@@ -3,6 +3,7 @@
 	근데 단발성 이벤트를 구현한다면 어떨끼?
 	굳이 Event, Condition Variable를 사용해야할까?
 	그럴 때 사용할 수 있는 것이 future인데 그렇게 자주 쓸 일은 없다고 한다.
+	(get()으로 기다리지 않고 값이 오면 이어서 할 일을 붙이는 방법은 Future.h, 39_FuturePipeline 참고)
 */
 
 #include <iostream>
@@ -1,6 +1,7 @@
 ﻿/*
 	서버는 비용이 어마어마하게 들어가는 장비이기 때문에 프로그래머가 최상의 효율을 뽑아내는 것이 중요하다.
 	그 방법중 하나가 캐시(Cache)를 이용하는 것인데 램까지 가서 데이터를 가져오는 시간을 줄여주기 때문에 효율적이다.
+	시간을 재서 숫자로 비교하는 건 45_CacheBenchmark에서 한다. (행/열 우선, stride, 작업 크기별 지연, False Sharing, 블록 단위 전치)
 */
 
 #include <iostream>
@@ -3,97 +3,14 @@
 	자료구조에 멀티스레드를 접목시켜보는 건데 이번엔 lock을 사용하는 자료구조이다.
 */
 
+#include "LockQueue.h"
 #include <iostream>
 #include <thread>
-#include <mutex>
-#include <stack>
-#include <queue>
+#include <vector>
 
 using namespace std;
 
-template<typename T>
-class LockStack
-{
-public:
-	LockStack() = default;
-	LockStack(const LockStack&) = delete;
-	LockStack& operator=(const LockStack&) = delete;
-
-	void Push(T val)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		stack.push(move(val));
-		cv.notify_one();
-	}
-
-	bool TryPop(T& val)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		if (stack.empty())
-			return false;
-
-		val = move(stack.top());
-
-		stack.pop();
-		return true;
-	}
-
-	void WaitPop(T& val)
-	{
-		std::unique_lock<std::mutex> lock(mutex);
-		cv.wait(lock, [] {return stack.empty() == false; });
-		val = std::move(stack.top());
-		stack.pop();
-	}
-private:
-	stack<T> stack;
-	mutex mutex;
-	condition_variable cv;
-};
-
-template<typename T>
-class LockQueue
-{
-public:
-	LockQueue() = default;
-	LockQueue(const LockQueue&) = delete;
-	LockQueue& operator = (const LockQueue&) = delete;
-
-	void Push(T& val)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-
-		queue.push(val);
-
-		cv.notify_one();
-	}
-
-	bool TryPop(T& val)
-	{
-		std::lock_guard<std::mutex> lock(mutex);
-		if (queue.empty())
-			return false;
-
-		val = std::move(queue.front());
-
-		queue.pop();
-		return true;
-	}
-
-	void WaitPop(T& val)
-	{
-		std::unique_lock<std::mutex> lock(mutex);
-		cv.wait(lock, [] {return queue.empty() == false; });
-		val = std::move(queue.top());
-		queue.pop();
-	}
-
-private:
-	std::queue<T> queue;
-	std::mutex mutex;
-	std::condition_variable cv;
-};
-
+//LockStack, LockQueue는 다른 파일에서도 쓸 수 있게 LockQueue.h로 옮겼다.
 
 LockStack<int> s;
 LockQueue<int> q;
@@ -108,24 +25,52 @@ void Push()
 	}
 }
 
+//한번의 lock으로 여러개를 넣는다.
+void PushBulk()
+{
+	vector<int> datas(100);
+	while (true)
+	{
+		for (int& data : datas)
+			data = rand();
+		q.PushBulk(datas.begin(), datas.end());
+		this_thread::sleep_for(5ms);
+	}
+}
 
 void Pop()
 {
 	while (true)
 	{
 		int data = 0;
-		if (q.TryPop(data))
+		if (q.WaitPopFor(data, 100ms))
 		{
 			printf("%d\n", data);
 		}
 	}
 }
 
+//한번 깨어날 때 쌓여있는걸 전부 가져간다.
+void PopAll()
+{
+	queue<int> datas;
+	while (true)
+	{
+		const size_t count = q.WaitPopAll(datas);
+		printf("wake up : %zu items\n", count);
+
+		while (datas.empty() == false)
+			datas.pop();
+	}
+}
+
 int main()
 {
 	thread t1(Push);
-	thread t2(Pop);
+	thread t2(PushBulk);
+	thread t3(PopAll);
 
 	t1.join();
 	t2.join();
+	t3.join();
 }
@@ -11,6 +11,7 @@
 #include <stack>
 #include <queue>
 #include <atomic>
+#include "CachePadded.h"
 
 using namespace std;
 
@@ -105,6 +106,8 @@ public:
 		{
 			//다른 스레드도 이 노드를 사용중
 			ChainPendingNode(oldHead);
+			//나는 Pop이 끝났으니 빠져야 한다. 안 빼면 popCount가 다시는 1이 되지 않는다.
+			popCount--;
 		}
 	}
 
@@ -141,7 +144,11 @@ public:
 	}
 
 private:
-	atomic<Node*> head;
+	/*
+		head는 Push/TryPop이, popCount는 TryPop이, pendingList는 삭제를 미루는 스레드가 계속 고친다.
+		셋이 한 캐시라인에 붙어있으면 서로 다른 변수를 고쳐도 캐시라인을 뺏고 뺏기니(False Sharing) 하나씩 떨어뜨린다. (CachePadded.h)
+	*/
+	CachePadded<atomic<Node*>> head;
 	/*
 		Pop에서 그냥 멋도 모르고 삭제를 하면 while문에서 CAS알고리즘으로 검사를 할 때
 		삭제한 포인터를 쓰려다가 프로그램이 터질 수도 있다.
@@ -149,8 +156,13 @@ private:
 		그 중 하나는 shared_ptr의 ref count를 비슷하게 따라하는 것 이다.
 	*/
 	//1. Pop을 실행중인 쓰레드 갯수를 체크
-	atomic<int> popCount = 0;	//Pop을 실행중인 쓰레드 갯수
-	atomic<Node*> pendingList;	//삭제되어야 할 노드들(제일 첫번째)
+	CachePadded<atomic<int>> popCount = 0;		//Pop을 실행중인 쓰레드 갯수
+	CachePadded<atomic<Node*>> pendingList;		//삭제되어야 할 노드들(제일 첫번째)
+
+	/*
+		Pop하는 스레드가 많아서 혼자가 되는 순간이 거의 없으면 pendingList는 계속 길어지기만 한다.
+		누가 어떤 노드를 보고 있는지를 기준으로 지우는 Hazard Pointer(HazardPointer.h, 32_HazardPointer)로 이 문제를 해결한다.
+	*/
 };
 
 LockFreeStack<int> s;
@@ -71,6 +71,7 @@ using namespace std;
 //물론 이 방식이 lock free라고 단정지을 수는 없다.
 //사용자의 pc 사양에 따라서 lock free여부가 바뀌기 때문.
 //일단은 "이건 lock free방식이다." 라는 전제하에 진행한다.
+//(운에 맡기지 않고 확실히 lock free로 16바이트 CAS를 하는 방법은 AtomicPair.h를 참고)
 template<typename T>
 class LockFreeStack
 {
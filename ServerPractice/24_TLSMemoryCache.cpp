@@ -0,0 +1,100 @@
+﻿/*
+	22_MemoryPool1의 메모리 풀은 모든 스레드가 풀 하나를 같이 쓴다.
+	스레드가 한두개일 때는 괜찮지만 서버처럼 워커 스레드가 수십개가 되면
+	Allocate/Release를 할 때마다 풀의 lock과 allocCount를 두고 경합이 일어나고
+	메모리 풀을 쓰는 이유(빠른 할당)가 사라져버린다.
+
+	그래서 스레드마다 자기만 쓰는 작은 캐시(Magazine)를 TLS에 두고
+	캐시가 비거나 넘칠 때만 공용 풀과 여러개를 한번에 주고받게 만들었다. (Memory.h 참고)
+	tcmalloc, jemalloc 같은 할당기들도 결국 이런 구조라고 한다.
+
+	이 파일은 세가지 방식의 속도를 스레드 수(1/4/16/64)에 따라 비교한다.
+	1. malloc/free
+	2. 공용 풀 (TLS 캐시 없음, 22_MemoryPool1 방식)
+	3. TLS 캐시 + 공용 풀
+*/
+
+#include "Memory.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	ITERATION_COUNT = 200000,	//스레드 하나가 할당/해제하는 횟수
+	WORKING_SET = 16			//한번에 들고 있는 블록 수
+};
+
+//실제 서버처럼 여러 크기의 할당이 섞여서 들어오게 한다.
+const __int32 sizes[] = { 16, 40, 64, 100, 200, 500, 1000, 3000 };
+
+struct MallocPolicy
+{
+	static void* Alloc(__int32 size) { return malloc(size); }
+	static void Release(void* ptr) { free(ptr); }
+};
+
+struct SharedPoolPolicy
+{
+	static void* Alloc(__int32 size) { return GMemory.AllocateNoCache(size); }
+	static void Release(void* ptr) { GMemory.ReleaseNoCache(ptr); }
+};
+
+struct CachedPoolPolicy
+{
+	static void* Alloc(__int32 size) { return GMemory.Allocate(size); }
+	static void Release(void* ptr) { GMemory.Release(ptr); }
+};
+
+template<typename Policy>
+void Worker()
+{
+	void* blocks[WORKING_SET];
+
+	for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+	{
+		for (__int32 j = 0; j < WORKING_SET; j++)
+		{
+			blocks[j] = Policy::Alloc(sizes[(i + j) % (sizeof(sizes) / sizeof(sizes[0]))]);
+			*static_cast<__int8*>(blocks[j]) = 1;
+		}
+
+		for (__int32 j = 0; j < WORKING_SET; j++)
+			Policy::Release(blocks[j]);
+	}
+}
+
+template<typename Policy>
+double Run(__int32 threadCount)
+{
+	auto start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (__int32 i = 0; i < threadCount; i++)
+		threads.push_back(thread(Worker<Policy>));
+
+	for (thread& t : threads)
+		t.join();
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	//초당 몇백만번 할당/해제 했는지
+	return (static_cast<double>(threadCount) * static_cast<double>(ITERATION_COUNT)) / elapsed.count() / 1000000.0;
+}
+
+int main()
+{
+	printf("%8s %14s %14s %14s\n", "threads", "malloc", "shared pool", "tls cache");
+
+	for (__int32 threadCount : { 1, 4, 16, 64 })
+	{
+		double mallocResult = Run<MallocPolicy>(threadCount);
+		double sharedResult = Run<SharedPoolPolicy>(threadCount);
+		double cachedResult = Run<CachedPoolPolicy>(threadCount);
+
+		printf("%8d %10.2f M/s %10.2f M/s %10.2f M/s\n", threadCount, mallocResult, sharedResult, cachedResult);
+	}
+}
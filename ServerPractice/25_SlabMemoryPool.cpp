@@ -0,0 +1,72 @@
+﻿/*
+	24_TLSMemoryCache까지의 메모리 풀은 블록이 모자라면 malloc으로 블록을 하나씩 만들었다.
+	그러면 서버가 막 켜졌을 때나 갑자기 접속자가 몰렸을 때 작은 malloc이 수천, 수만번 일어나고
+	그렇게 만들어진 블록들은 힙 여기저기에 흩어지게 된다.
+	흩어진 블록들을 돌아다니면서 쓰게 되면 캐시 미스도 많아지고 TLB(가상주소 -> 물리주소 변환 캐시)도 자주 미스가 난다.
+
+	그래서 이제는 블록이 모자라면 64KB짜리 Slab을 한번에 받아서 잘라 쓴다.
+	malloc 횟수가 블록 수만큼에서 Slab 수만큼으로 줄어들고, 같은 크기의 블록들은 메모리상에 붙어있게 된다.
+	그리고 Slab에 있는 블록이 전부 풀에 돌아오면 Trim으로 Slab을 통째로 돌려줄 수도 있다.
+*/
+
+#include "Memory.h"
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	BLOCK_SIZE = 64,
+	BLOCK_COUNT = 100000
+};
+
+int main()
+{
+	MemoryPool pool(BLOCK_SIZE);
+	vector<MemoryHeader*> blocks(BLOCK_COUNT);
+
+	//1. 풀이 텅 빈 상태에서 한번에 많이 가져가기 (서버가 막 켜졌을 때)
+	auto start = chrono::steady_clock::now();
+	for (MemoryHeader*& block : blocks)
+		block = pool.Pop();
+	chrono::duration<double, milli> slabElapsed = chrono::steady_clock::now() - start;
+
+	//비교를 위해 예전처럼 블록을 하나씩 malloc 해본다.
+	vector<void*> mallocBlocks(BLOCK_COUNT);
+	start = chrono::steady_clock::now();
+	for (void*& block : mallocBlocks)
+		block = malloc(BLOCK_SIZE);
+	chrono::duration<double, milli> mallocElapsed = chrono::steady_clock::now() - start;
+
+	//2. 연속으로 꺼낸 블록이 메모리상에서도 바로 옆에 붙어있는지 확인
+	__int32 adjacentCount = 0;
+	for (__int32 i = 1; i < BLOCK_COUNT; i++)
+	{
+		const __int64 distance = reinterpret_cast<__int8*>(blocks[i]) - reinterpret_cast<__int8*>(blocks[i - 1]);
+		if (distance == BLOCK_SIZE || distance == -BLOCK_SIZE)
+			adjacentCount++;
+	}
+
+	printf("slab refill   : %.2f ms, slab count %d (slab size %d)\n", slabElapsed.count(), pool.GetSlabCount(), pool.GetSlabSize());
+	printf("malloc refill : %.2f ms, malloc count %d\n", mallocElapsed.count(), BLOCK_COUNT);
+	printf("adjacent blocks : %d / %d\n", adjacentCount, BLOCK_COUNT - 1);
+
+	for (void* block : mallocBlocks)
+		free(block);
+
+	//3. 절반만 돌려주면 블록이 남아있는 Slab은 해제되지 않는다.
+	for (__int32 i = 0; i < BLOCK_COUNT / 2; i++)
+		pool.Push(blocks[i]);
+
+	__int32 releaseCount = pool.Trim();
+	printf("trim (half returned) : released %d, remain %d\n", releaseCount, pool.GetSlabCount());
+
+	//4. 전부 돌려주면 모든 Slab이 해제된다.
+	for (__int32 i = BLOCK_COUNT / 2; i < BLOCK_COUNT; i++)
+		pool.Push(blocks[i]);
+
+	releaseCount = pool.Trim();
+	printf("trim (all returned)  : released %d, remain %d\n", releaseCount, pool.GetSlabCount());
+}
@@ -0,0 +1,128 @@
+﻿/*
+	메모리 풀은 크기별로 풀을 나눠서 관리했다면 오브젝트 풀은 타입별로 풀을 나눠서 관리한다.
+	둘 다 쓰고 난 메모리를 바로 해제하지 않고 모아뒀다가 재활용 한다는 점은 똑같다.
+	오브젝트 풀의 장점이 하나 더 있다면 같은 타입끼리만 메모리를 재활용 하기 때문에
+	혹시 메모리 오염이 생겼을 때 어떤 타입에서 문제가 생겼는지 범위를 좁히기 쉽다는 것이다.
+
+	이 파일은 세가지 방식으로 객체를 만들고 지우는 속도를 비교한다.
+	1. new/delete
+	2. xnew/xdelete (크기별 메모리 풀)
+	3. ObjectPool<T> (타입별 오브젝트 풀)
+	그리고 make_shared와 MakeShared도 비교한다.
+*/
+
+#include "ObjectPool.h"
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+class Knight
+{
+public:
+	Knight() { count++; }
+	Knight(__int32 hp, __int32 attack) : hp(hp), attack(attack) { count++; }
+	~Knight() { count--; }
+
+	static inline __int32 count = 0;	//생성자/소멸자가 제대로 불렸는지 확인하기 위함
+
+	__int32 hp = 100;
+	__int32 attack = 10;
+	__int64 padding[4] = {};
+};
+
+enum
+{
+	ITERATION_COUNT = 1000000,
+	WORKING_SET = 64
+};
+
+template<typename Func>
+double Measure(Func func)
+{
+	auto start = chrono::steady_clock::now();
+	func();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main()
+{
+	Knight* knights[WORKING_SET];
+
+	double newElapsed = Measure([&]()
+	{
+		for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+		{
+			for (Knight*& knight : knights)
+				knight = new Knight(100, 10);
+			for (Knight* knight : knights)
+				delete knight;
+		}
+	});
+
+	double xnewElapsed = Measure([&]()
+	{
+		for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+		{
+			for (Knight*& knight : knights)
+				knight = xnew<Knight>(100, 10);
+			for (Knight* knight : knights)
+				xdelete(knight);
+		}
+	});
+
+	double poolElapsed = Measure([&]()
+	{
+		for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+		{
+			for (Knight*& knight : knights)
+				knight = ObjectPool<Knight>::Pop(100, 10);
+			for (Knight* knight : knights)
+				ObjectPool<Knight>::Push(knight);
+		}
+	});
+
+	printf("new/delete       : %.2f ms\n", newElapsed);
+	printf("xnew/xdelete     : %.2f ms\n", xnewElapsed);
+	printf("ObjectPool       : %.2f ms\n", poolElapsed);
+
+	vector<shared_ptr<Knight>> sharedKnights(WORKING_SET);
+
+	double makeSharedElapsed = Measure([&]()
+	{
+		for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+		{
+			for (shared_ptr<Knight>& knight : sharedKnights)
+				knight = make_shared<Knight>(100, 10);
+			for (shared_ptr<Knight>& knight : sharedKnights)
+				knight = nullptr;
+		}
+	});
+
+	double poolSharedElapsed = Measure([&]()
+	{
+		for (__int32 i = 0; i < ITERATION_COUNT / WORKING_SET; i++)
+		{
+			for (shared_ptr<Knight>& knight : sharedKnights)
+				knight = MakeShared<Knight>(100, 10);
+			for (shared_ptr<Knight>& knight : sharedKnights)
+				knight = nullptr;
+		}
+	});
+
+	printf("make_shared      : %.2f ms\n", makeSharedElapsed);
+	printf("MakeShared       : %.2f ms\n", poolSharedElapsed);
+
+	{
+		//MakeShared는 Knight만 따로 할당하지 않고 Control Block과 한번에 할당한다.
+		//그래서 ObjectPool<Knight>에서는 아무것도 꺼내가지 않는다. (전후로 alloc count가 같다)
+		const __int32 before = ObjectPool<Knight>::GetAllocCount();
+		shared_ptr<Knight> knight = MakeShared<Knight>(200, 20);
+		printf("MakeShared hp %d, ObjectPool<Knight> alloc count %d -> %d\n", knight->hp, before, ObjectPool<Knight>::GetAllocCount());
+	}
+
+	//생성자와 소멸자가 짝이 맞다면 0이 나와야 한다.
+	printf("alive knights : %d\n", Knight::count);
+}
@@ -0,0 +1,70 @@
+﻿/*
+	21_STLAllocator의 STLAllocator는 무조건 StompAllocator를 썼다.
+	StompAllocator는 1바이트를 할당해도 한 페이지(4KB)를 통째로 받아오고 매번 운영체제까지 다녀오기 때문에
+	원소를 수십만개 넣는 map 같은 컨테이너에 쓰면 메모리도 시간도 감당이 안된다.
+
+	이제 STLAllocator는 어떤 Allocator를 쓸지 Policy로 받는다. (Allocator.h)
+	기본값은 디버그 빌드에서는 StompAllocator, 릴리즈 빌드에서는 메모리 풀(PoolAllocator)이고
+	xvector, xmap 같은 이름(Container.h)을 쓰면 기본값이 알아서 들어간다.
+*/
+
+#include "Container.h"
+#include <cstdio>
+#include <chrono>
+
+using namespace std;
+
+enum
+{
+	ELEMENT_COUNT = 200000,
+	REPEAT_COUNT = 5
+};
+
+template<typename Func>
+double Measure(Func func)
+{
+	auto start = chrono::steady_clock::now();
+	for (__int32 i = 0; i < REPEAT_COUNT; i++)
+		func();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+template<typename Map>
+void FillMap()
+{
+	Map m;
+	for (__int32 i = 0; i < ELEMENT_COUNT; i++)
+		m[i] = i;
+}
+
+template<typename List>
+void FillList()
+{
+	List l;
+	for (__int32 i = 0; i < ELEMENT_COUNT; i++)
+		l.push_back(i);
+}
+
+int main()
+{
+	//Policy를 직접 골라서 쓸 수도 있다.
+	using PoolMap = map<__int32, __int32, less<__int32>, STLAllocator<pair<const __int32, __int32>, PoolAllocator>>;
+	using PoolUnorderedMap = unordered_map<__int32, __int32, hash<__int32>, equal_to<__int32>, STLAllocator<pair<const __int32, __int32>, PoolAllocator>>;
+	using PoolList = list<__int32, STLAllocator<__int32, PoolAllocator>>;
+
+	printf("map           : std %8.2f ms, pool %8.2f ms\n", Measure(FillMap<map<__int32, __int32>>), Measure(FillMap<PoolMap>));
+	printf("unordered_map : std %8.2f ms, pool %8.2f ms\n", Measure(FillMap<unordered_map<__int32, __int32>>), Measure(FillMap<PoolUnorderedMap>));
+	printf("list          : std %8.2f ms, pool %8.2f ms\n", Measure(FillList<list<__int32>>), Measure(FillList<PoolList>));
+
+	//평소에는 Container.h의 이름을 쓰면 된다.
+	xvector<__int32> v = { 1, 2, 3 };
+	xmap<__int32, xstring> names;
+	names[1] = "Knight";
+	names[2] = "Archer, a name long enough to skip the small string optimization";
+	xunordered_map<xstring, __int32> ids;
+	for (auto& [id, name] : names)
+		ids[name] = id;
+
+	printf("vector size %d, map size %d, unordered_map size %d\n", static_cast<__int32>(v.size()), static_cast<__int32>(names.size()), static_cast<__int32>(ids.size()));
+}
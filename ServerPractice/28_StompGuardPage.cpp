@@ -0,0 +1,125 @@
+﻿/*
+	20_StompAllocator의 StompAllocator는 할당할 때마다 VirtualAlloc, 해제할 때마다 VirtualFree를 불렀다.
+	디버그 빌드로 부하 테스트를 돌려보면 컨테이너 원소 하나, 패킷 하나마다 시스템 콜을 두번씩 하게 되는데
+	그러면 테스트 시간 대부분을 운영체제 안에서 보내게 되고 리눅스에서는 아예 컴파일도 안된다.
+
+	이제 StompAllocator(Allocator.h)는
+	1. 리눅스에서는 mmap/mprotect/munmap을 쓰고
+	2. 데이터 바로 뒤에 Guard Page를 둬서 끝을 넘어서 쓰면 무조건 터지고
+	3. 해제한 메모리를 바로 돌려주지 않고 접근 금지로 잡아둬서(Quarantine) Use-After-Free도 한동안 계속 터지고
+	4. 주소 공간을 Arena 단위로 한번에 예약해서 할당마다 하는 시스템 콜을 한번으로 줄였다.
+
+	아래의 TEST_OVERFLOW, TEST_USE_AFTER_FREE를 true로 바꾸면 실제로 터지는 것을 볼 수 있다.
+*/
+
+#include "Allocator.h"
+#include <cstdio>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+constexpr bool TEST_OVERFLOW = false;
+constexpr bool TEST_USE_AFTER_FREE = false;
+
+enum
+{
+	ALLOC_SIZE = 100,
+	ALLOC_COUNT = 20000
+};
+
+//20_StompAllocator처럼 할당마다 주소 공간을 받아오고 해제하면 바로 돌려주되 Guard Page만 붙인 버전
+//할당 한번에 시스템 콜이 세번(받아오기, Guard Page 설정, 돌려주기) 일어난다.
+class NaiveStompAllocator
+{
+public:
+	enum { PAGE_SIZE = 0x1000 };
+
+	static void* Alloc(__int32 size)
+	{
+		const __int64 pageCount = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+		const __int64 dataOffset = pageCount * PAGE_SIZE - size;
+
+#if defined(_WIN32)
+		__int8* baseAddress = static_cast<__int8*>(::VirtualAlloc(NULL, (pageCount + 1) * PAGE_SIZE, MEM_RESERVE, PAGE_NOACCESS));
+		::VirtualAlloc(baseAddress, pageCount * PAGE_SIZE, MEM_COMMIT, PAGE_READWRITE);
+#else
+		__int8* baseAddress = static_cast<__int8*>(::mmap(nullptr, (pageCount + 1) * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		::mprotect(baseAddress + pageCount * PAGE_SIZE, PAGE_SIZE, PROT_NONE);
+#endif
+		return static_cast<void*>(baseAddress + dataOffset);
+	}
+
+	static void Release(void* ptr, __int32 size)
+	{
+		const __int64 address = reinterpret_cast<__int64>(ptr);
+		const __int64 baseAddress = address - (address % PAGE_SIZE);
+#if defined(_WIN32)
+		::VirtualFree(reinterpret_cast<void*>(baseAddress), 0, MEM_RELEASE);
+#else
+		::munmap(reinterpret_cast<void*>(baseAddress), ((size + PAGE_SIZE - 1) / PAGE_SIZE + 1) * PAGE_SIZE);
+#endif
+	}
+};
+
+template<typename Func>
+double Measure(Func func)
+{
+	auto start = chrono::steady_clock::now();
+	func();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main()
+{
+	vector<void*> blocks(ALLOC_COUNT);
+
+	//실제로는 할당받은 메모리에 뭔가 쓰기 때문에 둘 다 한번씩 써준다.
+	double naiveElapsed = Measure([&]()
+	{
+		for (void*& block : blocks)
+		{
+			block = NaiveStompAllocator::Alloc(ALLOC_SIZE);
+			static_cast<__int8*>(block)[0] = 1;
+		}
+		for (void* block : blocks)
+			NaiveStompAllocator::Release(block, ALLOC_SIZE);
+	});
+
+	double stompElapsed = Measure([&]()
+	{
+		for (void*& block : blocks)
+		{
+			block = StompAllocator::Alloc(ALLOC_SIZE);
+			static_cast<__int8*>(block)[0] = 1;
+		}
+		for (void* block : blocks)
+			StompAllocator::Release(block);
+	});
+
+	//arena stomp는 Quarantine까지 하면서도 시스템 콜이 할당당 두번 조금 넘는 정도다.
+	printf("naive stomp (guard page)              : %.2f ms\n", naiveElapsed);
+	printf("arena stomp (guard page + quarantine) : %.2f ms\n", stompElapsed);
+
+	//데이터는 페이지 끝에 딱 붙어있다. 마지막 바이트까지는 마음대로 써도 된다.
+	__int8* data = static_cast<__int8*>(StompAllocator::Alloc(ALLOC_SIZE));
+	data[ALLOC_SIZE - 1] = 1;
+	printf("last byte ok, page offset %lld\n", static_cast<long long>(reinterpret_cast<unsigned __int64>(data + ALLOC_SIZE) % 0x1000));
+
+	//한 바이트라도 넘어가면 Guard Page라서 터진다.
+	if (TEST_OVERFLOW)
+		data[ALLOC_SIZE] = 1;
+
+	StompAllocator::Release(data);
+
+	//해제한 메모리는 QUARANTINE_COUNT번 해제가 더 일어나기 전까지 접근 금지 상태라서 터진다.
+	if (TEST_USE_AFTER_FREE)
+		data[0] = 1;
+
+	//STL 컨테이너도 Policy로 StompAllocator를 넘기면 그대로 쓸 수 있다.
+	vector<__int32, STLAllocator<__int32, StompAllocator>> v;
+	for (__int32 i = 0; i < 1000; i++)
+		v.push_back(i);
+	printf("vector size %d\n", static_cast<__int32>(v.size()));
+}
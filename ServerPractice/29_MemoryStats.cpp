@@ -0,0 +1,86 @@
+﻿/*
+	Memory의 크기별 풀 구간(SizeClass.h의 LG_STEPS, LG_MAX_SIZE)은 처음에는 감으로 정할 수밖에 없다.
+	실제 서버에서 어떤 크기가 얼마나 자주 할당되는지, TLS 캐시가 제 역할을 하는지를 봐야
+	풀의 단위나 MAGAZINE_SIZE, MAX_ALLOC_SIZE를 제대로 정할 수 있다.
+
+	GMemory.GetStats()는 모든 스레드의 카운터를 합쳐서 크기별 통계를 돌려주고
+	ToText()는 사람이 보기 좋게, ToJson()은 다른 도구로 넘기기 좋게 바꿔준다.
+	카운터는 스레드마다 따로 세기 때문에 할당하는 쪽은 다른 스레드와 싸울 일이 없다.
+*/
+
+#include "Memory.h"
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+using namespace std;
+using namespace std::chrono_literals;
+
+enum
+{
+	THREAD_COUNT = 4,
+	WORKING_SET = 128
+};
+
+//패킷 버퍼처럼 작은 크기가 대부분이고 가끔 큰 할당이 섞여 들어온다고 해보자.
+const __int32 sizes[] = { 24, 24, 24, 48, 48, 100, 200, 1000, 4000, 6000 };
+
+atomic<bool> stop = false;
+
+//leftovers에는 끝날 때 돌려주지 않은 블록을 남긴다. (outstanding에 잡히는지 보기 위함)
+void Work(__int32 seed, vector<void*>& leftovers)
+{
+	vector<void*> blocks(WORKING_SET, nullptr);
+
+	for (__int32 i = 0; stop == false; i++)
+	{
+		const __int32 slot = (i * 7 + seed) % WORKING_SET;
+		if (blocks[slot] != nullptr)
+			GMemory.Release(blocks[slot]);
+
+		blocks[slot] = GMemory.Allocate(sizes[(i + seed) % size(sizes)]);
+	}
+
+	//절반만 돌려주고 나머지는 들고 나간다.
+	for (__int32 i = 0; i < WORKING_SET; i++)
+	{
+		if (blocks[i] == nullptr)
+			continue;
+
+		if (i < WORKING_SET / 2)
+			GMemory.Release(blocks[i]);
+		else
+			leftovers.push_back(blocks[i]);
+	}
+}
+
+int main()
+{
+	vector<thread> threads;
+	vector<vector<void*>> leftovers(THREAD_COUNT);
+	for (__int32 i = 0; i < THREAD_COUNT; i++)
+		threads.push_back(thread(Work, i, ref(leftovers[i])));
+
+	//다른 스레드가 할당하는 중에도 읽을 수 있다.
+	this_thread::sleep_for(100ms);
+	MemoryStats running = GMemory.GetStats();
+	printf("while running : %d live threads\n\n", running.liveThreadCount);
+
+	stop = true;
+	for (thread& t : threads)
+		t.join();
+
+	//스레드는 끝났지만 끝나면서 남긴 통계는 그대로 합쳐져 있다.
+	MemoryStats stats = GMemory.GetStats();
+	printf("%s\n", stats.ToText().c_str());
+	printf("%s\n\n", stats.ToJson().c_str());
+
+	for (vector<void*>& blocks : leftovers)
+		for (void* block : blocks)
+			GMemory.Release(block);
+
+	//남은 블록까지 돌려주면 outstanding은 전부 0이 된다.
+	printf("%s", GMemory.GetStats().ToText().c_str());
+}
@@ -0,0 +1,141 @@
+﻿/*
+	Memory가 요청 크기에 맞는 풀을 찾는 방법을 두가지로 비교한다.
+	1. 예전 방식 : 손으로 만든 [0 ~ 4096] 크기의 표에서 찾기 (4KB, 캐시라인 64개)
+	2. 지금 방식 : SizeClass::ToIndex로 계산하기 (countl_zero + 시프트, 표 없음)
+
+	표를 찾는 것은 메모리를 한번 읽는 것이고 계산은 명령어 여덟개 정도가 줄줄이 이어진 것이다.
+	그래서 이 파일처럼 표가 L1 캐시에 다 올라와 있는 상태로 찾기만 반복하면 표가 더 빠르게 나온다.
+	계산 방식의 장점은 속도보다는
+	1. 캐시를 한 줄도 차지하지 않기 때문에 다른 코드가 쓸 L1 캐시를 빼앗지 않고
+	2. SizeClass의 LG_STEPS만 바꾸면 구간이 알아서 다시 계산된다(표를 손으로 고칠 필요가 없다)는 것이다.
+
+	처리량, 지연 시간, 그리고 할당 사이에 다른 메모리를 건드리는 경우(busy)의 지연 시간을 잰다.
+*/
+
+#include "Memory.h"
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	LOOKUP_COUNT = 1 << 16,
+	REPEAT_COUNT = 200,
+	BUSY_SIZE = 48 * 1024		//L1 캐시(보통 32~48KB)를 가득 채울 만큼
+};
+
+//예전 Memory 생성자가 만들던 표 (32/128/256 단위)
+class TableSizeClass
+{
+public:
+	TableSizeClass()
+	{
+		__int32 size = 0;
+		__int32 poolIndex = 0;
+		__int32 tableIndex = 0;
+
+		for (size = 32; size <= 1024; size += 32)
+			Add(size, poolIndex++, tableIndex);
+		for (size = 1024 + 128; size <= 2048; size += 128)
+			Add(size, poolIndex++, tableIndex);
+		for (size = 2048 + 256; size <= 4096; size += 256)
+			Add(size, poolIndex++, tableIndex);
+	}
+
+	__int32 ToIndex(__int32 size) const { return table[size]; }
+
+private:
+	void Add(__int32 size, __int32 poolIndex, __int32& tableIndex)
+	{
+		while (tableIndex <= size)
+			table[tableIndex++] = static_cast<unsigned __int8>(poolIndex);
+	}
+
+	unsigned __int8 table[4096 + 1];
+};
+
+template<typename Func>
+double Measure(Func func)
+{
+	auto start = chrono::steady_clock::now();
+	func();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main()
+{
+	//작은 크기가 대부분이고 큰 크기는 가끔 들어온다. (MemoryHeader 16바이트 포함)
+	mt19937 random(7);
+	exponential_distribution<double> distribution(1.0 / 200);
+	vector<__int32> sizes(LOOKUP_COUNT);
+	for (__int32& size : sizes)
+		size = min(16 + static_cast<__int32>(distribution(random)), 4096);
+
+	//할당 사이에 건드리는 다른 메모리
+	vector<__int32> busy(BUSY_SIZE / sizeof(__int32), 1);
+	vector<__int32> busyIndex(LOOKUP_COUNT);
+	for (__int32& index : busyIndex)
+		index = random() % busy.size();
+
+	TableSizeClass table;
+	__int64 sum = 0;
+
+	//1. 처리량 : 찾은 번호를 바로 쓰지 않기 때문에 CPU가 여러개를 동시에 진행할 수 있다.
+	double tableThroughput = Measure([&]()
+	{
+		for (__int32 r = 0; r < REPEAT_COUNT; r++)
+			for (__int32 size : sizes)
+				sum += table.ToIndex(size);
+	});
+
+	double computeThroughput = Measure([&]()
+	{
+		for (__int32 r = 0; r < REPEAT_COUNT; r++)
+			for (__int32 size : sizes)
+				sum += SizeClass::ToIndex(size);
+	});
+
+	//2. 지연 시간 : 실제 Allocate는 찾은 번호로 풀과 Magazine을 읽어야 다음으로 넘어갈 수 있다.
+	//   찾은 번호가 다음에 읽을 위치를 정하게 만들어서 한번에 하나씩만 진행되게 한다.
+	auto latency = [&](auto toIndex, bool touchBusy)
+	{
+		__int32 index = 0;
+		for (__int32 r = 0; r < REPEAT_COUNT; r++)
+		{
+			for (__int32 i = 0; i < LOOKUP_COUNT; i++)
+			{
+				index = toIndex(sizes[(i + index) & (LOOKUP_COUNT - 1)]);
+				if (touchBusy)
+					busy[busyIndex[i]]++;
+			}
+		}
+		sum += index;
+	};
+
+	auto tableToIndex = [&](__int32 size) { return table.ToIndex(size); };
+	auto computeToIndex = [](__int32 size) { return SizeClass::ToIndex(size); };
+
+	double tableLatency = Measure([&]() { latency(tableToIndex, false); });
+	double computeLatency = Measure([&]() { latency(computeToIndex, false); });
+	double tableBusy = Measure([&]() { latency(tableToIndex, true); });
+	double computeBusy = Measure([&]() { latency(computeToIndex, true); });
+
+	const double lookupCount = static_cast<double>(LOOKUP_COUNT) * static_cast<double>(REPEAT_COUNT);
+	printf("throughput     : table %.2f ns, compute %.2f ns\n", tableThroughput * 1e6 / lookupCount, computeThroughput * 1e6 / lookupCount);
+	printf("latency        : table %.2f ns, compute %.2f ns\n", tableLatency * 1e6 / lookupCount, computeLatency * 1e6 / lookupCount);
+	printf("latency (busy) : table %.2f ns, compute %.2f ns\n", tableBusy * 1e6 / lookupCount, computeBusy * 1e6 / lookupCount);
+	printf("(sum %lld)\n\n", sum);
+
+	//크기 구간과 구간별 최대 낭비 (요청 크기가 바로 앞 구간보다 1바이트 클 때. 첫 구간은 MemoryHeader만 있을 때가 앞 구간이다)
+	printf("%d size classes\n", static_cast<__int32>(SizeClass::COUNT));
+	for (__int32 index = 0; index < SizeClass::COUNT; index++)
+	{
+		const __int32 size = SizeClass::ToSize(index);
+		const __int32 prevSize = index == 0 ? static_cast<__int32>(sizeof(MemoryHeader)) : SizeClass::ToSize(index - 1);
+		printf("%5d (max waste %4.1f%%)%s", size, 100.0 * (size - prevSize - 1) / size, (index + SizeClass::SKIP_COUNT) % SizeClass::STEP_COUNT == SizeClass::STEP_COUNT - 1 ? "\n" : "   ");
+	}
+}
@@ -0,0 +1,206 @@
+﻿/*
+	LockQueue.h의 LockQueue(mutex + std::queue)와 MPMCQueue(MPMCQueue.h)를 비교한다.
+	Producer:Consumer 비율을 1:1, 1:4, 4:1, 4:4로 바꿔가면서
+	1. LockQueue     : Push / TryPop
+	2. MPMC try      : TryPush / TryPop (실패하면 yield)
+	3. MPMC blocking : Push / WaitPop (atomic::wait로 잠든다)
+	4. MPMC batch    : TryPushBatch / TryPopBatch (32개씩)
+	네가지 방식으로 ITEM_COUNT개를 주고받는 시간을 잰다.
+	Consumer가 꺼낸 값을 전부 더해서 하나도 빠지거나 두번 나오지 않았는지도 확인한다.
+*/
+
+#include "MPMCQueue.h"
+#include "LockQueue.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	ITEM_COUNT = 1 << 20,
+	QUEUE_CAPACITY = 1024,
+	BATCH_COUNT = 32
+};
+
+//Consumer에게 그만하라고 알려주는 값
+const __int64 STOP = -1;
+
+struct LockQueuePolicy
+{
+	LockQueue<__int64> queue;
+
+	void Push(__int64 value) { queue.Push(value); }
+	void PushRange(__int64 begin, __int64 end)
+	{
+		for (__int64 value = begin; value < end; value++)
+			queue.Push(value);
+	}
+	__int32 Pop(__int64* values)
+	{
+		while (queue.TryPop(values[0]) == false)
+			this_thread::yield();
+		return 1;
+	}
+};
+
+struct TryPolicy
+{
+	MPMCQueue<__int64> queue{ QUEUE_CAPACITY };
+
+	void Push(__int64 value)
+	{
+		while (queue.TryPush(value) == false)
+			this_thread::yield();
+	}
+	void PushRange(__int64 begin, __int64 end)
+	{
+		for (__int64 value = begin; value < end; value++)
+			Push(value);
+	}
+	__int32 Pop(__int64* values)
+	{
+		while (queue.TryPop(values[0]) == false)
+			this_thread::yield();
+		return 1;
+	}
+};
+
+struct BlockingPolicy
+{
+	MPMCQueue<__int64> queue{ QUEUE_CAPACITY };
+
+	void Push(__int64 value) { queue.Push(value); }
+	void PushRange(__int64 begin, __int64 end)
+	{
+		for (__int64 value = begin; value < end; value++)
+			queue.Push(value);
+	}
+	__int32 Pop(__int64* values)
+	{
+		queue.WaitPop(values[0]);
+		return 1;
+	}
+};
+
+struct BatchPolicy
+{
+	MPMCQueue<__int64> queue{ QUEUE_CAPACITY };
+
+	void Push(__int64 value)
+	{
+		while (queue.TryPush(value) == false)
+			this_thread::yield();
+	}
+	void PushRange(__int64 begin, __int64 end)
+	{
+		__int64 values[BATCH_COUNT];
+		while (begin < end)
+		{
+			const __int32 count = static_cast<__int32>(min<__int64>(BATCH_COUNT, end - begin));
+			for (__int32 i = 0; i < count; i++)
+				values[i] = begin + i;
+
+			__int32 pushed = 0;
+			while (pushed < count)
+			{
+				const __int32 result = queue.TryPushBatch(values + pushed, count - pushed);
+				if (result == 0)
+					this_thread::yield();
+				pushed += result;
+			}
+			begin += count;
+		}
+	}
+	__int32 Pop(__int64* values)
+	{
+		__int32 count = 0;
+		while ((count = queue.TryPopBatch(values, BATCH_COUNT)) == 0)
+			this_thread::yield();
+		return count;
+	}
+};
+
+template<typename Policy>
+double Run(__int32 producerCount, __int32 consumerCount)
+{
+	Policy policy;
+	vector<__int64> sums(consumerCount, 0);
+	vector<thread> producers;
+	vector<thread> consumers;
+
+	auto start = chrono::steady_clock::now();
+
+	for (__int32 c = 0; c < consumerCount; c++)
+	{
+		consumers.push_back(thread([&policy, &sums, c]()
+		{
+			__int64 values[BATCH_COUNT];
+			while (true)
+			{
+				const __int32 count = policy.Pop(values);
+				for (__int32 i = 0; i < count; i++)
+				{
+					if (values[i] == STOP)
+					{
+						//batch로 꺼내면 다른 Consumer 몫의 STOP까지 같이 가져올 수 있으니 돌려놓는다.
+						for (__int32 j = i + 1; j < count; j++)
+							policy.Push(STOP);
+						return;
+					}
+					sums[c] += values[i];
+				}
+			}
+		}));
+	}
+
+	//1 ~ ITEM_COUNT를 Producer 수만큼 나눠서 넣는다.
+	for (__int32 p = 0; p < producerCount; p++)
+	{
+		producers.push_back(thread([&policy, p, producerCount]()
+		{
+			const __int64 begin = 1 + static_cast<__int64>(ITEM_COUNT) * p / producerCount;
+			const __int64 end = 1 + static_cast<__int64>(ITEM_COUNT) * (p + 1) / producerCount;
+			policy.PushRange(begin, end);
+		}));
+	}
+
+	for (thread& t : producers)
+		t.join();
+
+	//Producer가 다 넣은 다음에 STOP을 넣기 때문에 STOP 뒤에는 STOP밖에 없다.
+	for (__int32 c = 0; c < consumerCount; c++)
+		policy.Push(STOP);
+
+	for (thread& t : consumers)
+		t.join();
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	__int64 sum = 0;
+	for (__int64 value : sums)
+		sum += value;
+
+	const __int64 expected = static_cast<__int64>(ITEM_COUNT) * (ITEM_COUNT + 1) / 2;
+	if (sum != expected)
+		printf("!! sum mismatch %lld != %lld\n", sum, expected);
+
+	return elapsed.count();
+}
+
+int main()
+{
+	const __int32 ratios[][2] = { { 1, 1 }, { 1, 4 }, { 4, 1 }, { 4, 4 } };
+
+	printf("  P:C    LockQueue     MPMC try  MPMC blocking   MPMC batch\n");
+	for (auto& ratio : ratios)
+	{
+		const double lockElapsed = Run<LockQueuePolicy>(ratio[0], ratio[1]);
+		const double tryElapsed = Run<TryPolicy>(ratio[0], ratio[1]);
+		const double blockingElapsed = Run<BlockingPolicy>(ratio[0], ratio[1]);
+		const double batchElapsed = Run<BatchPolicy>(ratio[0], ratio[1]);
+		printf("%3d:%-3d %9.2f ms %9.2f ms %11.2f ms %9.2f ms\n", ratio[0], ratio[1], lockElapsed, tryElapsed, blockingElapsed, batchElapsed);
+	}
+}
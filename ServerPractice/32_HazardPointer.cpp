@@ -0,0 +1,282 @@
+﻿/*
+	14_LockFree_Stack_1의 popCount/pendingList 방식과 HazardPointer.h의 Hazard Pointer 방식을 비교한다.
+
+	Pop하는 스레드 32개가 꺼냈다가 다시 넣기를 계속 반복하게 한다.
+	스택에 들어있는 노드 수는 항상 PREFILL_COUNT개 근처지만 Pop 할 때마다 노드 하나를 지워야 하고 Push 할 때마다 하나를 새로 만든다.
+	- popCount 방식은 Pop하는 스레드가 나 혼자인 순간이 거의 없어서 pendingList에 계속 쌓이고 RSS가 끝없이 올라간다.
+	- Hazard Pointer 방식은 스레드마다 들고 있는 노드 수가 정해져 있어서 RSS가 처음 그대로 유지된다.
+*/
+
+#include "HazardPointer.h"
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <atomic>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono_literals;
+
+enum
+{
+	THREAD_COUNT = 32,
+	PREFILL_COUNT = 1000,
+	SAMPLE_COUNT = 8,
+	RSS_LIMIT_MB = 1024		//popCount 방식은 끝없이 늘어나기 때문에 여기까지 오면 멈춘다.
+};
+
+//지금 프로세스가 실제로 쓰고 있는 물리 메모리 (Resident Set Size)
+__int64 GetRssBytes()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+	return static_cast<__int64>(counters.WorkingSetSize);
+#else
+	__int64 totalPages = 0;
+	__int64 residentPages = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+	if (fscanf(file, "%lld %lld", &totalPages, &residentPages) != 2)
+		residentPages = 0;
+	fclose(file);
+	return residentPages * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+//살아있는 노드 수 (두 스택 모두 Node 생성자/소멸자에서 센다)
+atomic<__int64> liveNodeCount = 0;
+
+///////////////////
+// PopCountStack //
+///////////////////
+//14_LockFree_Stack_1의 LockFreeStack과 같다.
+template<typename T>
+class PopCountStack
+{
+	struct Node
+	{
+		Node(const T& val) : Data(val), Next(nullptr) { liveNodeCount.fetch_add(1, memory_order_relaxed); }
+		~Node() { liveNodeCount.fetch_sub(1, memory_order_relaxed); }
+
+		T Data;
+		Node* Next;
+	};
+
+public:
+	~PopCountStack()
+	{
+		DeleteNodes(head.load());
+		DeleteNodes(pendingList.load());
+	}
+
+	void Push(const T& value)
+	{
+		Node* node = new Node(value);
+		node->Next = head;
+		while (head.compare_exchange_weak(node->Next, node) == false)
+		{
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		popCount++;
+		Node* oldHead = head;
+		while (oldHead && head.compare_exchange_weak(oldHead, oldHead->Next) == false)
+		{
+		}
+
+		if (oldHead == nullptr)
+		{
+			popCount--;
+			return false;
+		}
+
+		value = oldHead->Data;
+		TryDelete(oldHead);
+		return true;
+	}
+
+private:
+	void TryDelete(Node* oldHead)
+	{
+		if (popCount == 1)
+		{
+			Node* node = pendingList.exchange(nullptr);
+			if (--popCount == 0)
+				DeleteNodes(node);
+			else if (node != nullptr)
+				ChainPendingNodeList(node);
+
+			delete oldHead;
+		}
+		else
+		{
+			ChainPendingNodeList(oldHead, oldHead);
+			popCount--;
+		}
+	}
+
+	void ChainPendingNodeList(Node* first, Node* last)
+	{
+		last->Next = pendingList;
+		while (pendingList.compare_exchange_weak(last->Next, first) == false)
+		{
+		}
+	}
+
+	void ChainPendingNodeList(Node* node)
+	{
+		Node* lastNode = node;
+		while (lastNode->Next)
+			lastNode = lastNode->Next;
+
+		ChainPendingNodeList(node, lastNode);
+	}
+
+	void DeleteNodes(Node* node)
+	{
+		while (node)
+		{
+			Node* next = node->Next;
+			delete node;
+			node = next;
+		}
+	}
+
+private:
+	atomic<Node*> head = nullptr;
+	atomic<__int32> popCount = 0;
+	atomic<Node*> pendingList = nullptr;
+};
+
+/////////////////
+// HazardStack //
+/////////////////
+template<typename T>
+class HazardStack
+{
+	struct Node
+	{
+		Node(const T& val) : Data(val), Next(nullptr) { liveNodeCount.fetch_add(1, memory_order_relaxed); }
+		~Node() { liveNodeCount.fetch_sub(1, memory_order_relaxed); }
+
+		T Data;
+		Node* Next;
+	};
+
+public:
+	~HazardStack()
+	{
+		Node* node = head.load();
+		while (node)
+		{
+			Node* next = node->Next;
+			delete node;
+			node = next;
+		}
+	}
+
+	void Push(const T& value)
+	{
+		Node* node = new Node(value);
+		node->Next = head.load(memory_order_relaxed);
+		while (head.compare_exchange_weak(node->Next, node) == false)
+		{
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		HazardPointer hazard;
+		Node* oldHead = nullptr;
+		while (true)
+		{
+			//CAS가 실패하면 oldHead는 새 head로 바뀌지만 아직 보호되지 않은 상태다. 그래서 매번 다시 Protect 한다.
+			oldHead = hazard.Protect(head);
+			if (oldHead == nullptr)
+				return false;
+
+			//oldHead는 보호중이라 지워지지도, 다른 노드로 재사용되지도 않는다. (ABA도 생기지 않는다)
+			if (head.compare_exchange_strong(oldHead, oldHead->Next))
+				break;
+		}
+
+		//떼어낸 노드는 이제 내 것이다. 다른 스레드가 아직 보고 있을 수 있으니 지우는 건 HazardDomain에 맡긴다.
+		hazard.Reset();
+		value = oldHead->Data;
+		HazardRetire(oldHead);
+		return true;
+	}
+
+private:
+	atomic<Node*> head = nullptr;
+};
+
+template<typename Stack>
+void Run(const char* name)
+{
+	Stack stack;
+	for (__int32 i = 0; i < PREFILL_COUNT; i++)
+		stack.Push(i);
+
+	atomic<bool> stop = false;
+	atomic<__int64> popCount = 0;
+	vector<thread> threads;
+	for (__int32 i = 0; i < THREAD_COUNT; i++)
+	{
+		threads.push_back(thread([&]()
+		{
+			__int64 count = 0;
+			__int32 value = 0;
+			while (stop.load(memory_order_relaxed) == false)
+			{
+				if (stack.TryPop(value))
+				{
+					stack.Push(value);
+					count++;
+				}
+			}
+			popCount.fetch_add(count);
+		}));
+	}
+
+	printf("%s\n", name);
+	const __int64 startRss = GetRssBytes();
+	__int64 peakRss = startRss;
+	for (__int32 i = 0; i < SAMPLE_COUNT; i++)
+	{
+		this_thread::sleep_for(250ms);
+		const __int64 rss = GetRssBytes();
+		peakRss = max(peakRss, rss);
+		printf("  %5d ms : RSS %8.1f MB, live nodes %10lld\n", (i + 1) * 250, rss / (1024.0 * 1024.0), liveNodeCount.load());
+
+		if (rss > RSS_LIMIT_MB * 1024LL * 1024LL)
+		{
+			printf("  RSS limit reached, stopping early\n");
+			break;
+		}
+	}
+
+	stop = true;
+	for (thread& t : threads)
+		t.join();
+
+	printf("  pops %lld, peak RSS growth %.1f MB\n\n", popCount.load(), (peakRss - startRss) / (1024.0 * 1024.0));
+}
+
+int main()
+{
+	//Hazard Pointer를 먼저 돌린다. (popCount 방식이 늘려놓은 RSS는 해제해도 바로 줄지 않을 수 있다)
+	Run<HazardStack<__int32>>("HazardStack");
+	Run<PopCountStack<__int32>>("PopCountStack (14_LockFree_Stack_1)");
+}
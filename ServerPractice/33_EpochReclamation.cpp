@@ -0,0 +1,100 @@
+﻿/*
+	LockFreeStack.h의 LockFreeStack<T, Reclaim>을 회수 방법 세가지로 나란히 돌려본다.
+	1. SplitRefCount : 15_LockFree_Stack_2 방식. 읽기만 해도 128비트 CAS(카운트 올리기) + fetch_sub(카운트 돌려주기)
+	2. HazardReclaim : 읽을 때마다 Hazard 칸에 적고(seq_cst store) head를 다시 확인
+	3. EpochReclaim  : Pin/Unpin만 하고 노드는 그냥 읽는다. 대신 지우는 건 epoch가 두번 올라갈 때까지 미뤄진다.
+
+	읽기(TryPeek) 비율을 0%, 90%, 99%로 바꿔가면서 잰다.
+	읽기가 많아지면 SplitRefCount는 읽을 때마다 하는 128비트 CAS 때문에 나머지 둘보다 느려진다.
+	노드 하나만 읽을 때는 Hazard Pointer와 EBR 모두 fence 한번씩이라 비슷하다.
+	EBR이 확실히 앞서는 건 Guard 하나로 여러번 읽을 때다. (Pin은 제일 바깥에서 한번만 하고 Hazard는 읽을 때마다 적어야 한다)
+	그래서 마지막 줄은 Guard 하나 안에서 READ_BATCH번씩 읽는다.
+*/
+
+#include "LockFreeStack.h"
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	THREAD_COUNT = 4,
+	PREFILL_COUNT = 1000,
+	OPERATION_COUNT = 1 << 20,	//스레드 하나가 하는 연산 수
+	READ_BATCH = 16
+};
+
+//스레드마다 따로 쓰는 가벼운 난수 (xorshift)
+unsigned __int32 NextRandom(unsigned __int32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//readBatch > 1 이면 읽을 때 Guard 하나를 잡고 readBatch번 읽는다.
+template<typename Reclaim>
+double Run(__int32 readPercent, __int32 readBatch)
+{
+	LockFreeStack<__int32, Reclaim> stack;
+	for (__int32 i = 0; i < PREFILL_COUNT; i++)
+		stack.Push(i);
+
+	auto start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (__int32 t = 0; t < THREAD_COUNT; t++)
+	{
+		threads.push_back(thread([&stack, readPercent, readBatch, t]()
+		{
+			unsigned __int32 random = 2463534242u + t;
+			__int32 value = 0;
+			for (__int32 i = 0; i < OPERATION_COUNT; i += readBatch)
+			{
+				if (static_cast<__int32>(NextRandom(random) % 100) < readPercent)
+				{
+					typename Reclaim::Guard guard;
+					for (__int32 j = 0; j < readBatch; j++)
+						stack.TryPeek(value);
+				}
+				else if (stack.TryPop(value))
+				{
+					stack.Push(value);
+				}
+			}
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main()
+{
+	const __int32 readPercents[] = { 0, 90, 99 };
+
+	printf("read %%   SplitRefCount   HazardReclaim    EpochReclaim\n");
+	for (__int32 readPercent : readPercents)
+	{
+		const double refCountElapsed = Run<SplitRefCount>(readPercent, 1);
+		const double hazardElapsed = Run<HazardReclaim>(readPercent, 1);
+		const double epochElapsed = Run<EpochReclaim>(readPercent, 1);
+		printf("%5d%%  %11.2f ms  %11.2f ms  %11.2f ms\n", readPercent, refCountElapsed, hazardElapsed, epochElapsed);
+	}
+
+	{
+		const double refCountElapsed = Run<SplitRefCount>(99, READ_BATCH);
+		const double hazardElapsed = Run<HazardReclaim>(99, READ_BATCH);
+		const double epochElapsed = Run<EpochReclaim>(99, READ_BATCH);
+		printf("99%% x%d %10.2f ms  %11.2f ms  %11.2f ms\n", READ_BATCH, refCountElapsed, hazardElapsed, epochElapsed);
+	}
+
+	printf("\nepoch advanced %llu times\n", GEpochDomain.GetEpoch());
+}
@@ -0,0 +1,111 @@
+﻿/*
+	LockQueue.h의 LockQueue(mutex + std::queue)와 LockFreeQueue.h의 Michael-Scott 큐를 비교한다.
+	Producer:Consumer 비율을 1:1, 1:N, N:1, N:N으로 바꿔가면서 ITEM_COUNT개를 주고받는 시간을 잰다.
+	1. LockQueue           : Push / TryPop
+	2. LockFree (Hazard)   : LockFreeQueue<__int64, HazardReclaim>
+	3. LockFree (Epoch)    : LockFreeQueue<__int64, EpochReclaim>
+	Consumer가 꺼낸 값을 전부 더해서 하나도 빠지거나 두번 나오지 않았는지도 확인한다.
+
+	MPMCQueue(31_MPMCQueue)와 달리 크기 제한이 없어서 Producer가 큐가 꽉 찼다고 기다릴 일은 없다.
+	대신 넣을 때마다 노드를 풀에서 꺼내고 뺄 때마다 Reclaim을 거쳐서 풀로 돌려보낸다.
+
+	결과는 코어 수에 따라 크게 달라진다. 코어가 적으면 mutex를 두고 싸울 일이 거의 없어서
+	CAS를 여러번 하는 LockFreeQueue보다 LockQueue가 더 빠르게 나오기도 한다. (14_LockFree_Stack_1의 답변 참고)
+	lock free의 장점은 코어가 많아서 여러 스레드가 정말 동시에 큐를 만지거나, lock을 쥔 스레드가 멈춰버릴 수 있을 때 드러난다.
+*/
+
+#include "LockFreeQueue.h"
+#include "LockQueue.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	ITEM_COUNT = 1 << 20,
+	MANY = 4
+};
+
+//Consumer에게 그만하라고 알려주는 값
+const __int64 STOP = -1;
+
+template<typename Queue>
+double Run(__int32 producerCount, __int32 consumerCount)
+{
+	Queue queue;
+	vector<__int64> sums(consumerCount, 0);
+	vector<thread> producers;
+	vector<thread> consumers;
+
+	auto start = chrono::steady_clock::now();
+
+	for (__int32 c = 0; c < consumerCount; c++)
+	{
+		consumers.push_back(thread([&queue, &sums, c]()
+		{
+			__int64 value = 0;
+			while (true)
+			{
+				if (queue.TryPop(value) == false)
+				{
+					this_thread::yield();
+					continue;
+				}
+
+				if (value == STOP)
+					return;
+				sums[c] += value;
+			}
+		}));
+	}
+
+	//1 ~ ITEM_COUNT를 Producer 수만큼 나눠서 넣는다.
+	for (__int32 p = 0; p < producerCount; p++)
+	{
+		producers.push_back(thread([&queue, p, producerCount]()
+		{
+			const __int64 begin = 1 + static_cast<__int64>(ITEM_COUNT) * p / producerCount;
+			const __int64 end = 1 + static_cast<__int64>(ITEM_COUNT) * (p + 1) / producerCount;
+			for (__int64 value = begin; value < end; value++)
+				queue.Push(value);
+		}));
+	}
+
+	for (thread& t : producers)
+		t.join();
+
+	for (__int32 c = 0; c < consumerCount; c++)
+		queue.Push(STOP);
+
+	for (thread& t : consumers)
+		t.join();
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	__int64 sum = 0;
+	for (__int64 value : sums)
+		sum += value;
+
+	const __int64 expected = static_cast<__int64>(ITEM_COUNT) * (ITEM_COUNT + 1) / 2;
+	if (sum != expected)
+		printf("!! sum mismatch %lld != %lld\n", sum, expected);
+
+	return elapsed.count();
+}
+
+int main()
+{
+	const __int32 ratios[][2] = { { 1, 1 }, { 1, MANY }, { MANY, 1 }, { MANY, MANY } };
+
+	printf("  P:C    LockQueue   LockFree (Hazard)   LockFree (Epoch)\n");
+	for (auto& ratio : ratios)
+	{
+		const double lockElapsed = Run<LockQueue<__int64>>(ratio[0], ratio[1]);
+		const double hazardElapsed = Run<LockFreeQueue<__int64, HazardReclaim>>(ratio[0], ratio[1]);
+		const double epochElapsed = Run<LockFreeQueue<__int64, EpochReclaim>>(ratio[0], ratio[1]);
+		printf("%3d:%-3d %9.2f ms %15.2f ms %15.2f ms\n", ratio[0], ratio[1], lockElapsed, hazardElapsed, epochElapsed);
+	}
+}
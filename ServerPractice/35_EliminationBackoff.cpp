@@ -0,0 +1,98 @@
+﻿/*
+	LockFreeStack.h의 두 스택(HazardReclaim, SplitRefCount)에 Elimination.h의 EliminationArray를 끼웠을 때와 안 끼웠을 때를 비교한다.
+	스레드 수를 8, 16, 32, 64로 늘려가면서 모든 스레드가 Push/TryPop을 반반씩 섞어서 한다.
+	전체 연산 수는 스레드 수와 상관없이 OPERATION_COUNT로 같고, 초당 몇백만번 했는지(Mops/s)로 본다.
+
+	스레드가 늘어날수록 head 하나를 두고 CAS 실패가 늘어나서 Elimination 없는 쪽은 점점 느려진다.
+	Elimination을 끼우면 실패한 Push와 TryPop 일부가 배열에서 만나서 head를 거치지 않고 끝난다. (eliminated %)
+
+	코어가 적으면 스레드가 실제로 동시에 돌지 않아서 CAS가 별로 실패하지 않는다.
+	그러면 FAIL_THRESHOLD를 넘는 일이 드물어 Elimination이 거의 일어나지 않고 두 줄은 비슷하게 나온다.
+	(경합이 없을 때 손해를 보지 않는 것도 Elimination을 실패했을 때만 쓰는 이유다)
+*/
+
+#include "LockFreeStack.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	PREFILL_COUNT = 1000,
+	OPERATION_COUNT = 1 << 21	//모든 스레드가 하는 연산 수의 합
+};
+
+unsigned __int32 NextRandom(unsigned __int32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+struct Result
+{
+	double mops;
+	__int64 eliminatedCount;
+	double eliminatedPercent;
+};
+
+template<typename Stack>
+Result Run(__int32 threadCount)
+{
+	Stack stack;
+	for (__int32 i = 0; i < PREFILL_COUNT; i++)
+		stack.Push(i);
+
+	const __int32 operationCount = OPERATION_COUNT / threadCount;
+
+	auto start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (__int32 t = 0; t < threadCount; t++)
+	{
+		threads.push_back(thread([&stack, operationCount, t]()
+		{
+			unsigned __int32 random = 2463534242u + t;
+			__int32 value = 0;
+			for (__int32 i = 0; i < operationCount; i++)
+			{
+				if (NextRandom(random) & 1)
+					stack.Push(i);
+				else
+					stack.TryPop(value);
+			}
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	const __int32 total = operationCount * threadCount;
+	return Result{ total / elapsed.count() / 1000000.0, stack.GetEliminatedCount(), 100.0 * stack.GetEliminatedCount() / total };
+}
+
+template<typename Stack, typename EliminationStack>
+void Print(const char* name, __int32 threadCount)
+{
+	const Result plain = Run<Stack>(threadCount);
+	const Result eliminated = Run<EliminationStack>(threadCount);
+	printf("%-14s %3d %12.2f %16.2f %10lld (%.3f%%)\n", name, threadCount, plain.mops, eliminated.mops, eliminated.eliminatedCount, eliminated.eliminatedPercent);
+}
+
+int main()
+{
+	const __int32 threadCounts[] = { 8, 16, 32, 64 };
+
+	printf("stack        threads  Mops/s   Mops/s (Elimination)  eliminated\n");
+	for (__int32 threadCount : threadCounts)
+		Print<LockFreeStack<__int32, HazardReclaim>, LockFreeStack<__int32, HazardReclaim, EliminationArray>>("HazardReclaim", threadCount);
+
+	for (__int32 threadCount : threadCounts)
+		Print<LockFreeStack<__int32, SplitRefCount>, LockFreeStack<__int32, SplitRefCount, EliminationArray>>("SplitRefCount", threadCount);
+}
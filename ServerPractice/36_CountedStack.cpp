@@ -0,0 +1,134 @@
+﻿/*
+	CountedStack.h의 CountedStack이 steady state에서 정말 할당을 안 하는지 직접 세어본다.
+	전역 operator new를 바꿔서 스레드마다 몇번 불렸는지 센다. (할당 카운터 훅)
+	1. LockFreeStack<Job, SplitRefCount> : Push마다 new Node 한번
+	2. CountedStack<Job>                  : 노드는 스택의 MemoryPool에서 꺼내고 돌려준다.
+
+	스레드마다 BATCH개를 넣고 BATCH개를 빼는 걸 반복한다. 스택에 동시에 들어있는 노드는 THREAD_COUNT * BATCH개를 넘지 않는다.
+	처음 한바퀴(warm up)에서 풀이 그만큼 커지고 나면 두번째 바퀴(steady)에서는
+	operator new도 0번, 풀이 Slab을 새로 받아오는 것도 0번이어야 한다.
+	(MemoryPool은 Slab을 AlignedMalloc으로 받아서 operator new 훅에는 안 걸리기 때문에 Slab 수도 같이 본다)
+
+	시간은 CountedStack이 꼭 빠르게 나오지는 않는다. 노드 풀은 스택 하나를 모든 스레드가 같이 쓰는 SList라서
+	꺼내고 돌려줄 때마다 128비트 CAS를 하고, glibc의 malloc은 스레드마다 캐시(tcache)가 있어서 작은 할당은 꽤 빠르다.
+	할당을 없애서 얻는 건 속도보다는 할당기 안에서의 경합과 단편화가 사라지고 메모리 사용량이 일정해진다는 점이다.
+*/
+
+#include "CountedStack.h"
+#include "LockFreeStack.h"
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	THREAD_COUNT = 4,
+	BATCH = 64,
+	ROUND_COUNT = 1 << 12		//스레드 하나가 BATCH개 넣고 빼기를 반복하는 횟수
+};
+
+//이 스레드에서 operator new가 불린 횟수 (L은 Local)
+thread_local __int64 LAllocCount = 0;
+
+void* operator new(size_t size)
+{
+	LAllocCount++;
+	if (void* ptr = malloc(size == 0 ? 1 : size))
+		return ptr;
+	throw bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+//캐시라인 하나 크기의 일감. 노드 안에 그대로 들어간다.
+struct Job
+{
+	__int64 id = 0;
+	__int64 payload[7] = {};
+};
+
+struct Result
+{
+	double elapsed;
+	__int64 allocCount;
+};
+
+template<typename Stack>
+Result Run(Stack& stack)
+{
+	vector<__int64> allocCounts(THREAD_COUNT, 0);
+	vector<thread> threads;
+
+	auto start = chrono::steady_clock::now();
+
+	for (__int32 t = 0; t < THREAD_COUNT; t++)
+	{
+		threads.push_back(thread([&stack, &allocCounts, t]()
+		{
+			const __int64 before = LAllocCount;
+
+			Job job;
+			for (__int32 round = 0; round < ROUND_COUNT; round++)
+			{
+				for (__int32 i = 0; i < BATCH; i++)
+				{
+					job.id = i;
+					stack.Push(job);
+				}
+
+				for (__int32 i = 0; i < BATCH; i++)
+					stack.TryPop(job);
+			}
+
+			allocCounts[t] = LAllocCount - before;
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	__int64 allocCount = 0;
+	for (__int64 count : allocCounts)
+		allocCount += count;
+
+	return Result{ elapsed.count(), allocCount };
+}
+
+int main()
+{
+	const __int64 operationCount = static_cast<__int64>(THREAD_COUNT) * ROUND_COUNT * BATCH * 2;
+
+	{
+		LockFreeStack<Job, SplitRefCount> stack;
+		const Result warmUp = Run(stack);
+		const Result steady = Run(stack);
+		printf("LockFreeStack<SplitRefCount>\n");
+		printf("  warm up %8.2f ms, operator new %lld\n", warmUp.elapsed, warmUp.allocCount);
+		printf("  steady  %8.2f ms, operator new %lld (%.2f / op)\n", steady.elapsed, steady.allocCount, static_cast<double>(steady.allocCount) / operationCount);
+	}
+
+	{
+		CountedStack<Job> stack;
+		const Result warmUp = Run(stack);
+		const __int32 slabCount = stack.GetSlabCount();
+		const Result steady = Run(stack);
+		printf("CountedStack\n");
+		printf("  warm up %8.2f ms, operator new %lld, slab %d\n", warmUp.elapsed, warmUp.allocCount, slabCount);
+		printf("  steady  %8.2f ms, operator new %lld, new slab %d\n", steady.elapsed, steady.allocCount, stack.GetSlabCount() - slabCount);
+
+		//optional로 꺼내기
+		stack.Push(Job{ 42 });
+		if (optional<Job> job = stack.TryPop())
+			printf("  TryPop() -> id %lld\n", job->id);
+		if (stack.TryPop().has_value() == false)
+			printf("  TryPop() -> empty\n");
+	}
+}
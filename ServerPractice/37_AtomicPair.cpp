@@ -0,0 +1,122 @@
+﻿/*
+	AtomicPair.h가 이 빌드에서 어떤 방법으로 16바이트 CAS를 하는지 보고
+	std::atomic<16바이트 구조체>와 나란히 돌려본다.
+
+	THREAD_COUNT개의 스레드가 (포인터, tag)를 CAS로 계속 한칸씩 옮긴다.
+	tag는 지금까지 성공한 횟수이고 포인터는 항상 slots[tag % SLOT_COUNT]를 가리키게 한다.
+	CAS가 정말 16바이트를 한번에 바꾼다면 언제 읽어도 포인터와 tag가 어긋날 일이 없다.
+
+	gcc의 std::atomic<16바이트>는 libatomic을 부르기 때문에 -latomic을 같이 링크해야 한다.
+	-DATOMIC_PAIR_DISABLE_DWCAS로 빌드하면 포인터 48비트 + tag 16비트 방식으로 바뀐다. (tag가 65536마다 한바퀴 돈다)
+*/
+
+#include "AtomicPair.h"
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	THREAD_COUNT = 4,
+	OPERATION_COUNT = 1 << 18,		//스레드 하나가 성공시키는 CAS 수
+	SLOT_COUNT = 256				//65536의 약수여야 tag가 한바퀴 돌아도 맞는다.
+};
+
+struct Slot
+{
+	__int64 dummy;
+};
+
+Slot slots[SLOT_COUNT];
+
+//std::atomic과 비교하기 위한 같은 모양의 16바이트 구조체
+struct alignas(16) Pair
+{
+	Slot* ptr;
+	unsigned __int64 tag;
+};
+
+template<typename Func>
+double Measure(Func&& func)
+{
+	auto start = chrono::steady_clock::now();
+
+	vector<thread> threads;
+	for (__int32 t = 0; t < THREAD_COUNT; t++)
+		threads.push_back(thread(func));
+
+	for (thread& t : threads)
+		t.join();
+
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+int main()
+{
+	printf("backend          : %s\n", ATOMIC_PAIR_BACKEND);
+	printf("tag bits         : %d\n", static_cast<__int32>(AtomicTaggedPtr<Slot>::TAG_BITS));
+	printf("std::atomic<16B> : is_always_lock_free %d, is_lock_free %d\n", atomic<Pair>::is_always_lock_free, atomic<Pair>().is_lock_free());
+
+	const unsigned __int64 total = static_cast<unsigned __int64>(THREAD_COUNT) * OPERATION_COUNT;
+	const unsigned __int64 tagMask = AtomicTaggedPtr<Slot>::TAG_BITS == 64 ? ~0ull : (1ull << AtomicTaggedPtr<Slot>::TAG_BITS) - 1;
+
+	{
+		AtomicTaggedPtr<Slot> top;
+		top.Store(TaggedPtr<Slot>{ &slots[0], 0 });
+		atomic<__int64> tornCount = 0;
+
+		const double elapsed = Measure([&]()
+		{
+			TaggedPtr<Slot> expected = top.LoadRelaxed();
+			for (__int32 i = 0; i < OPERATION_COUNT; )
+			{
+				if (expected.ptr != &slots[expected.tag % SLOT_COUNT])
+				{
+					//LoadRelaxed로 읽은 첫 값은 섞여 있을 수 있다. 다시 제대로 읽는다.
+					expected = top.Load();
+					if (expected.ptr != &slots[expected.tag % SLOT_COUNT])
+						tornCount++;
+					continue;
+				}
+
+				const unsigned __int64 tag = expected.tag + 1;
+				if (top.CompareExchange(expected, TaggedPtr<Slot>{ &slots[tag % SLOT_COUNT], tag }))
+				{
+					expected = TaggedPtr<Slot>{ &slots[tag % SLOT_COUNT], tag & tagMask };
+					i++;
+				}
+			}
+		});
+
+		const TaggedPtr<Slot> last = top.Load();
+		printf("AtomicTaggedPtr  : %8.2f ms, tag %llu (expected %llu), torn %lld\n", elapsed, last.tag, total & tagMask, tornCount.load());
+	}
+
+	{
+		atomic<Pair> top = Pair{ &slots[0], 0 };
+		atomic<__int64> tornCount = 0;
+
+		const double elapsed = Measure([&]()
+		{
+			Pair expected = top.load();
+			for (__int32 i = 0; i < OPERATION_COUNT; )
+			{
+				if (expected.ptr != &slots[expected.tag % SLOT_COUNT])
+					tornCount++;
+
+				const unsigned __int64 tag = expected.tag + 1;
+				if (top.compare_exchange_strong(expected, Pair{ &slots[tag % SLOT_COUNT], tag }))
+				{
+					expected = Pair{ &slots[tag % SLOT_COUNT], tag };
+					i++;
+				}
+			}
+		});
+
+		printf("std::atomic<16B> : %8.2f ms, tag %llu (expected %llu), torn %lld\n", elapsed, top.load().tag, total, tornCount.load());
+	}
+}
@@ -0,0 +1,109 @@
+﻿/*
+	08_Future의 Calc()를 범위를 나눠서 더하는 parallel for로 바꿔서 세가지 방법을 비교한다.
+	1. Single       : 스레드 하나로 처음부터 끝까지 더한다.
+	2. std::async   : 조각마다 std::async(launch::async)를 부른다. 조각 하나에 스레드 하나가 새로 생긴다.
+	3. ThreadPool   : ThreadPool.h의 ParallelFor. 미리 만든 일꾼들이 조각을 나눠 갖고 놀고 있으면 서로 훔쳐간다.
+	조각 크기(grain)를 크게/작게 바꿔가면서 재고 결과가 전부 같은지도 확인한다.
+
+	조각이 크면 스레드를 만드는 비용이 묻혀서 std::async도 나쁘지 않다.
+	조각이 작아지면 std::async는 조각 수만큼 스레드를 만들고 지우느라 대부분의 시간을 쓴다.
+	ThreadPool은 조각이 작아져도 덱에 포인터 하나 넣고 빼는 비용만 늘어난다.
+	(코어가 하나뿐인 환경이라면 셋 다 Single보다 빠를 수 없다. 그때는 나누는 비용만 비교된다)
+*/
+
+#include "ThreadPool.h"
+#include <cstdio>
+#include <chrono>
+#include <future>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	DATA_COUNT = 1 << 24,
+	REPEAT_COUNT = 5
+};
+
+vector<__int32> GData;
+
+//08_Future의 Calc를 [first, last) 범위만 더하도록 바꿨다.
+__int64 Calc(__int64 first, __int64 last)
+{
+	__int64 sum = 0;
+	for (__int64 i = first; i < last; i++)
+		sum += GData[i];
+
+	return sum;
+}
+
+__int64 RunSingle(__int64)
+{
+	return Calc(0, DATA_COUNT);
+}
+
+__int64 RunAsync(__int64 grain)
+{
+	vector<future<__int64>> futures;
+	for (__int64 first = 0; first < DATA_COUNT; first += grain)
+		futures.push_back(async(launch::async, Calc, first, min<__int64>(first + grain, DATA_COUNT)));
+
+	__int64 sum = 0;
+	for (future<__int64>& f : futures)
+		sum += f.get();
+	return sum;
+}
+
+ThreadPool* GPool = nullptr;
+
+__int64 RunPool(__int64 grain)
+{
+	//조각마다 결과를 atomic 하나에 더하면 그 캐시라인을 두고 싸우게 되지만 조각 수가 많지 않아서 괜찮다.
+	atomic<__int64> sum = 0;
+	GPool->ParallelFor(0, DATA_COUNT, grain, [&sum](__int64 first, __int64 last)
+	{
+		sum.fetch_add(Calc(first, last), memory_order_relaxed);
+	});
+	return sum.load(memory_order_relaxed);
+}
+
+//REPEAT_COUNT번 돌려서 가장 빠른 시간을 쓴다.
+double Measure(__int64 (*run)(__int64), __int64 grain, __int64 expected)
+{
+	double best = 1e30;
+	for (__int32 i = 0; i < REPEAT_COUNT; i++)
+	{
+		auto start = chrono::steady_clock::now();
+		const __int64 sum = run(grain);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+		if (sum != expected)
+			printf("!! sum mismatch %lld != %lld\n", sum, expected);
+		best = min(best, elapsed.count());
+	}
+	return best;
+}
+
+int main()
+{
+	GData.resize(DATA_COUNT);
+	for (__int32 i = 0; i < DATA_COUNT; i++)
+		GData[i] = i % 1000;
+
+	ThreadPool pool;
+	GPool = &pool;
+
+	const __int64 expected = Calc(0, DATA_COUNT);
+	printf("workers %d\n", pool.GetWorkerCount());
+	printf("     grain   chunks     Single   std::async   ThreadPool\n");
+
+	const __int64 grains[] = { DATA_COUNT / 16, DATA_COUNT / 256, DATA_COUNT / 4096 };
+	for (__int64 grain : grains)
+	{
+		const double singleElapsed = Measure(RunSingle, grain, expected);
+		const double asyncElapsed = Measure(RunAsync, grain, expected);
+		const double poolElapsed = Measure(RunPool, grain, expected);
+		printf("%10lld %8lld %7.2f ms %9.2f ms %9.2f ms\n",
+			grain, DATA_COUNT / grain, singleElapsed, asyncElapsed, poolElapsed);
+	}
+}
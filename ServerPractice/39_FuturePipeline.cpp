@@ -0,0 +1,221 @@
+﻿/*
+	요청 하나가 Parse -> DB 조회 -> Respond를 거치는 파이프라인을 REQUEST_COUNT개 동시에 처리한다.
+	DB(Database)는 스레드 하나가 LATENCY마다 쌓인 조회를 한꺼번에 처리하는 흉내만 낸다.
+
+	1. std::future : 요청마다 std::async로 스레드를 만들고 그 안에서 DB 조회 결과를 get()으로 기다린다.
+	                 조회가 끝날 때까지 요청 수만큼의 스레드가 get()에서 잠들어 있다.
+	2. Future      : Future.h의 Then으로 단계를 잇는다. DB 조회는 Future를 돌려주기만 하고 아무도 기다리지 않는다.
+	                 값이 오면 그 다음 단계가 ThreadPool에 들어가기 때문에 스레드는 일꾼 수만큼만 쓴다.
+	두 방법 모두 동시에 잠들어 있던 스레드 수의 최대값과 걸린 시간을 출력하고 응답을 전부 더해서 같은지 확인한다.
+
+	마지막에 같은 조회를 빠른 DB와 느린 DB에 동시에 보내고 WhenAny로 먼저 온 쪽을 쓰는 것도 해본다.
+	실패한 단계는 뒤의 Then을 건너뛰고 Get에서 예외로 나오는 것, 값을 넣지 않은 Promise가 broken_promise가 되는 것도 확인한다.
+*/
+
+#include "Future.h"
+#include <cstdio>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	REQUEST_COUNT = 2000
+};
+
+//조회를 모아뒀다가 latency마다 한꺼번에 응답한다. PromiseType은 std::promise<__int64> 또는 Promise<__int64>
+template<typename PromiseType>
+class Database
+{
+public:
+	Database(chrono::milliseconds latency) : latency(latency), worker([this]() { Run(); }) {}
+
+	~Database()
+	{
+		stop = true;
+		worker.join();
+	}
+
+	auto Query(__int64 key)
+	{
+		PromiseType promise;
+		auto future = GetFuture(promise);
+
+		lock_guard<mutex> lock(m);
+		pending.push_back({ key, std::move(promise) });
+		return future;
+	}
+
+private:
+	void Run()
+	{
+		while (stop == false || HasPending())
+		{
+			this_thread::sleep_for(latency);
+
+			vector<pair<__int64, PromiseType>> batch;
+			{
+				lock_guard<mutex> lock(m);
+				batch.swap(pending);
+			}
+
+			//값은 key * 2
+			for (auto& [key, promise] : batch)
+				SetValue(promise, key * 2);
+		}
+	}
+
+	bool HasPending()
+	{
+		lock_guard<mutex> lock(m);
+		return pending.empty() == false;
+	}
+
+	static std::future<__int64> GetFuture(std::promise<__int64>& promise) { return promise.get_future(); }
+	static Future<__int64> GetFuture(Promise<__int64>& promise) { return promise.GetFuture(); }
+	static void SetValue(std::promise<__int64>& promise, __int64 value) { promise.set_value(value); }
+	static void SetValue(Promise<__int64>& promise, __int64 value) { promise.SetValue(value); }
+
+private:
+	chrono::milliseconds latency;
+	mutex m;
+	vector<pair<__int64, PromiseType>> pending;
+	atomic<bool> stop = false;
+	thread worker;
+};
+
+__int64 Parse(__int64 request) { return request + 1; }
+__int64 Respond(__int64 row) { return row + 1; }
+
+//지금 잠들어 있는 스레드 수와 그 최대값
+atomic<__int32> GBlockedCount = 0;
+atomic<__int32> GMaxBlockedCount = 0;
+
+void EnterBlocked()
+{
+	const __int32 count = GBlockedCount.fetch_add(1) + 1;
+	__int32 max = GMaxBlockedCount.load();
+	while (count > max && GMaxBlockedCount.compare_exchange_weak(max, count) == false) {}
+}
+
+void LeaveBlocked()
+{
+	GBlockedCount.fetch_sub(1);
+}
+
+__int64 RunStdFuture()
+{
+	Database<std::promise<__int64>> db(chrono::milliseconds(1));
+
+	vector<std::future<__int64>> responses;
+	for (__int64 request = 0; request < REQUEST_COUNT; request++)
+	{
+		responses.push_back(async(launch::async, [&db, request]()
+		{
+			std::future<__int64> row = db.Query(Parse(request));
+
+			EnterBlocked();
+			const __int64 value = row.get();
+			LeaveBlocked();
+
+			return Respond(value);
+		}));
+	}
+
+	__int64 sum = 0;
+	for (std::future<__int64>& response : responses)
+		sum += response.get();
+	return sum;
+}
+
+__int64 RunFuture(ThreadPool& pool)
+{
+	Database<Promise<__int64>> db(chrono::milliseconds(1));
+
+	vector<Future<__int64>> responses;
+	for (__int64 request = 0; request < REQUEST_COUNT; request++)
+	{
+		responses.push_back(Async(pool, [request]() { return Parse(request); })
+			.Then(pool, [&db](__int64 key) { return db.Query(key); })
+			.Then(pool, [](__int64 row) { return Respond(row); }));
+	}
+
+	//main만 마지막에 한번 기다린다.
+	EnterBlocked();
+	vector<__int64> values = WhenAll(std::move(responses)).Get();
+	LeaveBlocked();
+
+	__int64 sum = 0;
+	for (__int64 value : values)
+		sum += value;
+	return sum;
+}
+
+int main()
+{
+	ThreadPool pool;
+	const __int64 expected = static_cast<__int64>(REQUEST_COUNT) * (REQUEST_COUNT - 1) + REQUEST_COUNT * 3LL;
+
+	{
+		GMaxBlockedCount = 0;
+		auto start = chrono::steady_clock::now();
+		const __int64 sum = RunStdFuture();
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		printf("std::future : %8.2f ms, max blocked threads %5d %s\n", elapsed.count(), GMaxBlockedCount.load(), sum == expected ? "" : "!! sum mismatch");
+	}
+
+	{
+		GMaxBlockedCount = 0;
+		auto start = chrono::steady_clock::now();
+		const __int64 sum = RunFuture(pool);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		printf("Future      : %8.2f ms, max blocked threads %5d (workers %d) %s\n", elapsed.count(), GMaxBlockedCount.load(), pool.GetWorkerCount(), sum == expected ? "" : "!! sum mismatch");
+	}
+
+	{
+		Database<Promise<__int64>> fast(chrono::milliseconds(1));
+		Database<Promise<__int64>> slow(chrono::milliseconds(50));
+
+		vector<Future<__int64>> replicas;
+		replicas.push_back(slow.Query(21));
+		replicas.push_back(fast.Query(21));
+
+		pair<__int32, __int64> first = WhenAny(std::move(replicas)).Get();
+		printf("WhenAny     : replica %d answered first with %lld\n", first.first, first.second);
+	}
+
+	{
+		bool respondCalled = false;
+		Future<__int64> response = Async(pool, []() -> __int64 { throw runtime_error("parse failed"); })
+			.Then(pool, [&respondCalled](__int64 row) { respondCalled = true; return Respond(row); });
+
+		try
+		{
+			response.Get();
+		}
+		catch (const exception& e)
+		{
+			printf("Throw       : %s (Respond called: %s)\n", e.what(), respondCalled ? "yes" : "no");
+		}
+
+		Future<__int64> orphan;
+		{
+			Promise<__int64> promise;
+			orphan = promise.GetFuture();
+		}
+
+		try
+		{
+			orphan.Get();
+		}
+		catch (const future_error& e)
+		{
+			printf("Broken      : %s\n", e.code() == future_errc::broken_promise ? "broken_promise" : e.what());
+		}
+	}
+}
@@ -0,0 +1,164 @@
+﻿/*
+	Coroutine.h의 Task와 awaitable들을 써본다.
+	1. HandleRequest : 39_FuturePipeline의 Parse -> DB 조회 -> Respond를 Then 없이 위에서 아래로 쓴다.
+	                   DB 조회는 Future를 돌려주고 co_await로 기다린다. 기다리는 동안 일꾼은 다른 요청을 처리한다.
+	2. AsyncMutex    : 모든 요청이 응답을 공용 로그(vector)에 남긴다. lock을 기다리는 동안 스레드가 아니라 코루틴이 줄을 선다.
+	3. AsyncEvent    : 06_Event처럼 서버가 열릴 때까지(Manual Reset) 요청들이 기다렸다가 한꺼번에 시작한다.
+	4. PopAsync      : 코루틴 Consumer들이 LockQueue에서 일을 꺼내간다. 큐가 비면 코루틴만 멈춘다.
+	마지막에 GMemory의 통계를 출력해서 코루틴 프레임이 크기별 풀에서 나갔다가 전부 돌아왔는지 본다.
+*/
+
+#include "Coroutine.h"
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	REQUEST_COUNT = 2000,
+	CONSUMER_COUNT = 4,
+	JOB_COUNT = 10000
+};
+
+//39_FuturePipeline의 Database를 간단하게 줄였다. 조회를 모아뒀다가 1ms마다 한꺼번에 key * 2로 응답한다.
+class Database
+{
+public:
+	Database() : worker([this]() { Run(); }) {}
+
+	~Database()
+	{
+		stop = true;
+		worker.join();
+	}
+
+	Future<__int64> Query(__int64 key)
+	{
+		Promise<__int64> promise;
+		Future<__int64> future = promise.GetFuture();
+
+		lock_guard<mutex> lock(m);
+		pending.push_back({ key, std::move(promise) });
+		return future;
+	}
+
+private:
+	void Run()
+	{
+		while (true)
+		{
+			this_thread::sleep_for(1ms);
+
+			vector<pair<__int64, Promise<__int64>>> batch;
+			{
+				lock_guard<mutex> lock(m);
+				batch.swap(pending);
+			}
+
+			if (batch.empty() && stop)
+				return;
+
+			for (auto& [key, promise] : batch)
+				promise.SetValue(key * 2);
+		}
+	}
+
+private:
+	mutex m;
+	vector<pair<__int64, Promise<__int64>>> pending;
+	atomic<bool> stop = false;
+	thread worker;
+};
+
+Database* GDatabase = nullptr;
+AsyncEvent GServerOpen(true, false);
+AsyncMutex GLogLock;
+vector<__int64> GLog;
+
+Task<__int64> Respond(__int64 row)
+{
+	//다른 코루틴이 로그를 쓰고 있으면 여기서 멈췄다가 차례가 오면 이어서 한다.
+	co_await GLogLock.LockAsync();
+	GLog.push_back(row);
+	GLogLock.Unlock();
+
+	co_return row + 1;
+}
+
+Task<__int64> HandleRequest(__int64 request)
+{
+	co_await GServerOpen.Wait();
+
+	const __int64 key = request + 1;
+	const __int64 row = co_await GDatabase->Query(key);
+	co_return co_await Respond(row);
+}
+
+Task<__int64> Consume(LockQueue<__int64>& jobs)
+{
+	__int64 sum = 0;
+	while (true)
+	{
+		__int64 job = 0;
+		co_await PopAsync(jobs, job);
+		if (job < 0)
+			break;
+		sum += job;
+	}
+	co_return sum;
+}
+
+int main()
+{
+	ThreadPool pool;
+	Database db;
+	GDatabase = &db;
+
+	//1, 2, 3
+	{
+		auto start = chrono::steady_clock::now();
+
+		vector<Future<__int64>> responses;
+		for (__int64 request = 0; request < REQUEST_COUNT; request++)
+			responses.push_back(Spawn(pool, HandleRequest(request)));
+
+		//전부 GServerOpen에서 멈춰 있다. 스레드는 하나도 막혀 있지 않다.
+		this_thread::sleep_for(10ms);
+		printf("requests waiting for server open : %d ready\n", static_cast<__int32>(count_if(responses.begin(), responses.end(), [](Future<__int64>& f) { return f.IsReady(); })));
+		GServerOpen.Set();
+
+		__int64 sum = 0;
+		for (__int64 value : WhenAll(std::move(responses)).Get())
+			sum += value;
+
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		const __int64 expected = static_cast<__int64>(REQUEST_COUNT) * (REQUEST_COUNT - 1) + REQUEST_COUNT * 3LL;
+		printf("requests %d : %.2f ms, log %d entries %s\n", REQUEST_COUNT, elapsed.count(), static_cast<__int32>(GLog.size()), sum == expected ? "" : "!! sum mismatch");
+	}
+
+	//4
+	{
+		LockQueue<__int64> jobs;
+		vector<Future<__int64>> consumers;
+		for (__int32 i = 0; i < CONSUMER_COUNT; i++)
+			consumers.push_back(Spawn(pool, Consume(jobs)));
+
+		for (__int64 job = 1; job <= JOB_COUNT; job++)
+			jobs.Push(job);
+		for (__int32 i = 0; i < CONSUMER_COUNT; i++)
+			jobs.Push(-1);
+
+		__int64 sum = 0;
+		for (__int64 value : WhenAll(std::move(consumers)).Get())
+			sum += value;
+
+		const __int64 expected = static_cast<__int64>(JOB_COUNT) * (JOB_COUNT + 1) / 2;
+		printf("PopAsync consumers %d : sum %lld %s\n", CONSUMER_COUNT, sum, sum == expected ? "" : "!! sum mismatch");
+	}
+
+	printf("\n%s", GMemory.GetStats().ToText().c_str());
+}
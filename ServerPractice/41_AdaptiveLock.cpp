@@ -0,0 +1,148 @@
+﻿/*
+	Lock.h의 AdaptiveLock을 지금까지 나온 lock들과 비교한다.
+	1. std::mutex    : 03_Mutex
+	2. SpinLock      : 04_SpinLock의 SpinLock 그대로 (CAS만 계속 반복)
+	3. SleepLock     : 05_Sleep의 SpinLock 그대로 (실패하면 100ms 잔다)
+	4. AdaptiveLock  : 잠깐 돌다가 안되면 잠든다.
+
+	THREAD_COUNT개 스레드가 DURATION 동안 lock을 잡고 critical section을 실행하기를 반복한다.
+	critical section이 짧을 때(카운터 하나 올리기)와 길 때(WORK_COUNT번 계산)를 나눠서
+	1초에 몇번 lock을 잡았는지(처리량)와 lock 하나를 얻기까지 가장 오래 기다린 시간(최악 지연)을 출력한다.
+
+	SleepLock은 처리량이 아니라 최악 지연을 보면 된다. 한번 실패하면 적어도 100ms를 기다린다.
+	SpinLock은 코어 수보다 스레드가 많으면 lock을 쥔 스레드가 CPU를 못 받는 동안 나머지가 타임슬라이스를 통째로 태운다.
+*/
+
+#include "Lock.h"
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	THREAD_COUNT = 4,
+	WORK_COUNT = 2000		//긴 critical section에서 하는 계산 횟수
+};
+
+const chrono::milliseconds DURATION(300);
+
+//04_SpinLock
+class SpinLock
+{
+public:
+	void lock()
+	{
+		bool expected = false;
+		while (locked.compare_exchange_strong(expected, true) == false)
+			expected = false;
+	}
+
+	void unlock() { locked = false; }
+
+private:
+	atomic<bool> locked = false;
+};
+
+//05_Sleep
+class SleepLock
+{
+public:
+	void lock()
+	{
+		bool expected = false;
+		while (locked.compare_exchange_strong(expected, true) == false)
+		{
+			expected = false;
+			this_thread::sleep_for(100ms);
+		}
+	}
+
+	void unlock() { locked = false; }
+
+private:
+	atomic<bool> locked = false;
+};
+
+struct Result
+{
+	double opsPerSecond;
+	double maxWaitUs;
+};
+
+template<typename Lock>
+Result Run(bool longSection)
+{
+	Lock lock;
+	atomic<bool> stop = false;
+	__int64 counter = 0;
+	volatile __int64 sink = 0;
+
+	vector<__int64> counts(THREAD_COUNT, 0);
+	vector<double> maxWaits(THREAD_COUNT, 0.0);
+	vector<thread> threads;
+
+	for (__int32 t = 0; t < THREAD_COUNT; t++)
+	{
+		threads.push_back(thread([&, t]()
+		{
+			while (stop.load(memory_order_relaxed) == false)
+			{
+				auto start = chrono::steady_clock::now();
+				lock_guard<Lock> guard(lock);
+				chrono::duration<double, micro> wait = chrono::steady_clock::now() - start;
+				maxWaits[t] = max(maxWaits[t], wait.count());
+
+				counter++;
+				if (longSection)
+				{
+					__int64 value = counter;
+					for (__int32 i = 0; i < WORK_COUNT; i++)
+						value = value * 6364136223846793005LL + 1442695040888963407LL;
+					sink = value;
+				}
+				counts[t]++;
+			}
+		}));
+	}
+
+	auto start = chrono::steady_clock::now();
+	this_thread::sleep_for(DURATION);
+	stop = true;
+	for (thread& t : threads)
+		t.join();
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+	__int64 total = 0;
+	for (__int64 count : counts)
+		total += count;
+	if (total != counter)
+		printf("!! counter mismatch %lld != %lld\n", counter, total);
+
+	return Result{ total / elapsed.count(), *max_element(maxWaits.begin(), maxWaits.end()) };
+}
+
+template<typename Lock>
+void Print(const char* name)
+{
+	const Result shortResult = Run<Lock>(false);
+	const Result longResult = Run<Lock>(true);
+	printf("%-14s %12.0f ops/s %12.1f us  | %12.0f ops/s %12.1f us\n", name,
+		shortResult.opsPerSecond, shortResult.maxWaitUs, longResult.opsPerSecond, longResult.maxWaitUs);
+}
+
+int main()
+{
+	printf("threads %d, hardware threads %u\n", THREAD_COUNT, thread::hardware_concurrency());
+	printf("%-14s %29s  | %29s\n", "", "short section (ops, max wait)", "long section (ops, max wait)");
+
+	Print<mutex>("std::mutex");
+	Print<SpinLock>("SpinLock");
+	Print<SleepLock>("SleepLock");
+	Print<AdaptiveLock>("AdaptiveLock");
+}
@@ -0,0 +1,136 @@
+﻿/*
+	Lock.h의 RWSpinLock을 std::shared_mutex, std::mutex와 비교한다.
+	THREAD_COUNT개 스레드가 TABLE_SIZE칸짜리 테이블을 OPERATION_COUNT번씩 읽거나 쓴다.
+	읽기 비율을 50%부터 99.9%까지 바꿔가면서 걸린 시간을 잰다.
+
+	쓰기는 모든 칸을 1씩 올리고 읽기는 모든 칸이 같은 값인지 확인한다.
+	lock이 제대로 막아주지 못하면 쓰는 도중의 테이블을 읽게 되어서 torn 수가 0이 아니게 나온다.
+
+	std::mutex는 읽기끼리도 서로 막는다. 읽기 비율이 높을수록 RWSpinLock, shared_mutex와 차이가 벌어진다.
+	shared_mutex는 잡을 때마다 커널 객체(또는 pthread_rwlock)를 거치고, RWSpinLock은 CAS 한번이다.
+	대신 RWSpinLock은 잠들지 않고 돌기 때문에 쓰기 lock을 오래 잡는 곳에는 맞지 않는다.
+*/
+
+#include "Lock.h"
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	THREAD_COUNT = 4,
+	OPERATION_COUNT = 1 << 18,		//스레드 하나가 하는 읽기+쓰기 수
+	TABLE_SIZE = 16
+};
+
+//lock마다 잡는 방법이 달라서 한번 감싼다.
+struct RWSpinLockPolicy
+{
+	RWSpinLock lock;
+	void ReadLock() { lock.ReadLock(); }
+	void ReadUnlock() { lock.ReadUnlock(); }
+	void WriteLock() { lock.WriteLock(); }
+	void WriteUnlock() { lock.WriteUnlock(); }
+};
+
+struct SharedMutexPolicy
+{
+	shared_mutex lock;
+	void ReadLock() { lock.lock_shared(); }
+	void ReadUnlock() { lock.unlock_shared(); }
+	void WriteLock() { lock.lock(); }
+	void WriteUnlock() { lock.unlock(); }
+};
+
+struct MutexPolicy
+{
+	mutex lock;
+	void ReadLock() { lock.lock(); }
+	void ReadUnlock() { lock.unlock(); }
+	void WriteLock() { lock.lock(); }
+	void WriteUnlock() { lock.unlock(); }
+};
+
+template<typename Policy>
+double Run(double readRatio, __int64& tornCount)
+{
+	Policy policy;
+	__int64 table[TABLE_SIZE] = {};
+	atomic<__int64> torn = 0;
+	vector<thread> threads;
+
+	//1000분의 몇을 읽을지
+	const unsigned __int32 readPermille = static_cast<unsigned __int32>(readRatio * 1000);
+
+	auto start = chrono::steady_clock::now();
+	for (__int32 t = 0; t < THREAD_COUNT; t++)
+	{
+		threads.push_back(thread([&, t]()
+		{
+			unsigned __int32 random = 2463534242u + t;
+			__int64 localTorn = 0;
+			for (__int32 i = 0; i < OPERATION_COUNT; i++)
+			{
+				random ^= random << 13;
+				random ^= random >> 17;
+				random ^= random << 5;
+
+				if (random % 1000 < readPermille)
+				{
+					policy.ReadLock();
+					for (__int32 k = 1; k < TABLE_SIZE; k++)
+						if (table[k] != table[0])
+							localTorn++;
+					policy.ReadUnlock();
+				}
+				else
+				{
+					policy.WriteLock();
+					for (__int32 k = 0; k < TABLE_SIZE; k++)
+						table[k]++;
+					policy.WriteUnlock();
+				}
+			}
+			torn += localTorn;
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+	tornCount = torn;
+	return elapsed.count();
+}
+
+int main()
+{
+	const double readRatios[] = { 0.5, 0.9, 0.99, 0.999 };
+
+	printf("threads %d, %d operations each\n", THREAD_COUNT, OPERATION_COUNT);
+	printf("  read%%     RWSpinLock   shared_mutex     std::mutex   torn\n");
+	for (double readRatio : readRatios)
+	{
+		__int64 torn[3] = {};
+		const double rwElapsed = Run<RWSpinLockPolicy>(readRatio, torn[0]);
+		const double sharedElapsed = Run<SharedMutexPolicy>(readRatio, torn[1]);
+		const double mutexElapsed = Run<MutexPolicy>(readRatio, torn[2]);
+		printf("%7.1f %11.2f ms %11.2f ms %11.2f ms %6lld\n", readRatio * 100, rwElapsed, sharedElapsed, mutexElapsed, torn[0] + torn[1] + torn[2]);
+	}
+
+	//쓰기 lock을 잡은 채로 다시 잡거나 읽어도 된다.
+	RWSpinLock lock;
+	{
+		WriteLockGuard outer(lock);
+		WriteLockGuard inner(lock);
+		ReadLockGuard read(lock);
+	}
+	ReadLockGuard after(lock);
+	printf("reentrant write -> write -> read : ok\n");
+}
@@ -0,0 +1,155 @@
+﻿/*
+	LockProfiler.h로 lock마다 얼마나 기다렸는지 잰다.
+	03_Mutex의 Add/Sub(mutex), 04_SpinLock의 Add/Sub(SpinLock)을 그대로 가져오고
+	가끔만 잡지만 한번 잡으면 오래 쥐고 있는 lock(AdaptiveLock)을 하나 더 둔다.
+	lock_guard 자리만 PROFILED_LOCK_GUARD로 바꾸고 GetReport()로 많이 기다린 순서대로 출력한다.
+
+	처음에는 lock을 잡는 횟수가 가장 많은 곳이 문제일 것 같지만
+	실제로는 가끔 오래 잡는 lock 하나가 다른 스레드들을 더 오래 세워두기도 한다. 그래서 횟수가 아니라 기다린 시간 합으로 줄을 세운다.
+
+	마지막으로 경합이 없을 때 lock_guard와 PROFILED_LOCK_GUARD가 한번에 얼마나 걸리는지 비교해서 재는 비용을 본다.
+	-DLOCK_PROFILE=0으로 빌드하면 PROFILED_LOCK_GUARD는 lock_guard가 되어서 두 줄이 같아지고 리포트는 비어있다.
+*/
+
+#include "LockProfiler.h"
+#include "Lock.h"
+#include <cstdio>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	LOOP_COUNT = 100000,
+	OVERHEAD_LOOP_COUNT = 1 << 22
+};
+
+//04_SpinLock
+class SpinLock
+{
+public:
+	void lock()
+	{
+		bool expected = false;
+		while (locked.compare_exchange_strong(expected, true) == false)
+			expected = false;
+	}
+
+	void unlock() { locked = false; }
+
+private:
+	atomic<bool> locked = false;
+};
+
+mutex m;
+SpinLock spinLock;
+AdaptiveLock configLock;
+__int64 num = 0;
+__int64 spinNum = 0;
+__int64 config = 0;
+volatile __int64 sink = 0;
+
+//03_Mutex
+void Add()
+{
+	for (__int32 i = 0; i < LOOP_COUNT; i++)
+	{
+		PROFILED_LOCK_GUARD(m);
+		num++;
+	}
+}
+
+void Sub()
+{
+	for (__int32 i = 0; i < LOOP_COUNT; i++)
+	{
+		PROFILED_LOCK_GUARD(m);
+		num--;
+	}
+}
+
+//04_SpinLock
+void SpinAdd()
+{
+	for (__int32 i = 0; i < LOOP_COUNT; i++)
+	{
+		PROFILED_LOCK_GUARD(spinLock);
+		spinNum++;
+	}
+}
+
+void SpinSub()
+{
+	for (__int32 i = 0; i < LOOP_COUNT; i++)
+	{
+		PROFILED_LOCK_GUARD(spinLock);
+		spinNum--;
+	}
+}
+
+//가끔 설정을 다시 읽는다고 치고 lock을 쥔 채로 오래 일한다.
+void ReloadConfig()
+{
+	for (__int32 i = 0; i < 20; i++)
+	{
+		{
+			PROFILED_LOCK_GUARD(configLock);
+			this_thread::sleep_for(2ms);
+			config++;
+		}
+		this_thread::sleep_for(1ms);
+	}
+}
+
+//설정을 자주 읽는다.
+void ReadConfig()
+{
+	for (__int32 i = 0; i < LOOP_COUNT; i++)
+	{
+		PROFILED_LOCK_GUARD(configLock);
+		sink = config;
+	}
+}
+
+int main()
+{
+	vector<thread> threads;
+	threads.push_back(thread(Add));
+	threads.push_back(thread(Sub));
+	threads.push_back(thread(SpinAdd));
+	threads.push_back(thread(SpinSub));
+	threads.push_back(thread(ReloadConfig));
+	threads.push_back(thread(ReadConfig));
+
+	for (thread& t : threads)
+		t.join();
+
+	printf("num %lld, spinNum %lld\n\n", num, spinNum);
+	printf("%s\n", GLockProfiler.GetReport().ToText().c_str());
+
+	//경합이 없을 때 한번 잡고 푸는 데 드는 시간
+	mutex overheadLock;
+	{
+		auto start = chrono::steady_clock::now();
+		for (__int32 i = 0; i < OVERHEAD_LOOP_COUNT; i++)
+		{
+			lock_guard<mutex> guard(overheadLock);
+			num++;
+		}
+		chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+		printf("lock_guard          : %6.2f ns\n", elapsed.count() / static_cast<double>(OVERHEAD_LOOP_COUNT));
+	}
+	{
+		auto start = chrono::steady_clock::now();
+		for (__int32 i = 0; i < OVERHEAD_LOOP_COUNT; i++)
+		{
+			PROFILED_LOCK_GUARD(overheadLock);
+			num++;
+		}
+		chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+		printf("PROFILED_LOCK_GUARD : %6.2f ns\n", elapsed.count() / static_cast<double>(OVERHEAD_LOOP_COUNT));
+	}
+}
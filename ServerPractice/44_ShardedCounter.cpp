@@ -0,0 +1,79 @@
+﻿/*
+	02_Atomic의 atomic<int> num과 ShardedCounter.h의 ShardedCounter를 비교한다.
+	스레드 수를 1, 2, 4, 8, 16으로 늘려가면서 스레드마다 INCREMENT_COUNT번 1을 더하고 걸린 시간을 잰다.
+	1. atomic<int>     : 모든 스레드가 같은 캐시라인에 fetch_add
+	2. ShardedCounter  : 스레드마다 다른 칸(캐시라인)에 fetch_add
+
+	코어가 여러개면 atomic<int>는 스레드가 늘수록 한번에 드는 시간(ns/op)이 늘어나고 ShardedCounter는 거의 그대로다.
+	코어가 하나면 캐시라인을 뺏길 일 자체가 없어서 둘이 비슷하게 나온다.
+	마지막 합이 스레드 수 * INCREMENT_COUNT와 같은지도 확인한다.
+*/
+
+#include "ShardedCounter.h"
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	INCREMENT_COUNT = 1 << 22,
+	MAX_THREAD_COUNT = 16
+};
+
+template<typename Counter, typename Increment, typename Read>
+double Run(__int32 threadCount, Increment increment, Read read)
+{
+	Counter counter;
+	vector<thread> threads;
+
+	auto start = chrono::steady_clock::now();
+	for (__int32 t = 0; t < threadCount; t++)
+	{
+		threads.push_back(thread([&counter, increment]()
+		{
+			for (__int32 i = 0; i < INCREMENT_COUNT; i++)
+				increment(counter);
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+	chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+
+	const __int64 expected = static_cast<__int64>(threadCount) * INCREMENT_COUNT;
+	if (read(counter) != expected)
+		printf("!! sum mismatch %lld != %lld\n", read(counter), expected);
+
+	//스레드 하나가 한번 올리는 데 걸린 시간
+	return elapsed.count() / expected * threadCount;
+}
+
+int main()
+{
+	printf("hardware threads %u\n", thread::hardware_concurrency());
+	printf("threads   atomic<int>   ShardedCounter  (ns/op per thread)\n");
+
+	for (__int32 threadCount = 1; threadCount <= MAX_THREAD_COUNT; threadCount *= 2)
+	{
+		const double atomicElapsed = Run<atomic<int>>(threadCount,
+			[](atomic<int>& counter) { counter.fetch_add(1, memory_order_relaxed); },
+			[](atomic<int>& counter) { return static_cast<__int64>(counter.load()); });
+
+		const double shardedElapsed = Run<ShardedCounter>(threadCount,
+			[](ShardedCounter& counter) { counter.Increment(); },
+			[](ShardedCounter& counter) { return counter.Get(); });
+
+		printf("%7d %10.2f ns %13.2f ns\n", threadCount, atomicElapsed, shardedElapsed);
+	}
+
+	//GetApprox는 마지막 Get 때의 값이다.
+	ShardedCounter counter;
+	counter.Add(10);
+	const __int64 before = counter.GetApprox();
+	const __int64 exact = counter.Get();
+	printf("GetApprox before Get %lld, Get %lld, GetApprox after Get %lld\n", before, exact, counter.GetApprox());
+}
@@ -0,0 +1,325 @@
+﻿/*
+	09_Cache는 buffer를 행 우선으로 두번 도는데 시간을 재지 않아서 캐시가 얼마나 차이를 내는지 숫자로 볼 수 없었다.
+	여기서는 09_Cache의 buffer에서 시작해서 캐시/메모리 계층을 하나씩 재본다.
+	1. RowColumn    : 09_Cache의 buffer[10000][10000]을 행 우선 / 열 우선으로 한번씩 더한다.
+	2. Stride       : 큰 배열에서 stride 바이트 간격으로 같은 수만큼 읽는다.
+	                  캐시라인(64바이트)보다 간격이 좁으면 한번 가져온 캐시라인을 여러번 쓰고, 넓으면 읽을 때마다 새 캐시라인을 가져온다.
+	3. WorkingSet   : 배열 크기를 4KB부터 늘려가며 캐시라인마다 하나씩 반복해서 읽는다. (순서대로라서 prefetch가 도와준다)
+	4. PointerChase : 배열 크기를 늘려가며 무작위 순서로 이어진 포인터를 따라간다.
+	                  다음 주소를 알려면 지금 읽은 값이 있어야 해서 prefetch가 안 되고 한번 읽는 시간(지연)이 그대로 보인다.
+	                  크기가 L1 -> L2 -> L3 -> 메모리를 넘어가는 지점마다 시간이 계단처럼 뛴다.
+	5. FalseSharing : 스레드마다 자기 카운터만 올린다. 카운터들이 한 캐시라인에 붙어있을 때와 캐시라인마다 떨어뜨렸을 때를 비교한다.
+	                  코어가 하나뿐이면 스레드들이 번갈아 돌 뿐 캐시라인을 두고 싸우지 않아서 차이가 나지 않는다. (Host의 hardware-threads를 같이 본다)
+	6. Transpose    : 행렬을 뒤집을 때(전치) 그냥 돌면 한쪽은 열 우선이 된다. TILE x TILE 블록 단위로 돌면 블록이 캐시에 들어가서 양쪽 다 캐시를 탄다.
+
+	결과는 서버마다 비교할 수 있게 CSV(기본) 또는 JSON으로 출력한다.  45_CacheBenchmark [csv|json]
+	(09_Cache처럼 buffer를 전역 배열로 두면 실행 파일이 뜰 때 400MB를 잡기 때문에 vector로 바꿨다)
+*/
+
+#include "Types.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	BUFFER_SIZE = 10000,				//09_Cache의 buffer[10000][10000]
+	STRIDE_ARRAY_BYTES = 1 << 28,		//256MB
+	STRIDE_ACCESS_COUNT = 1 << 22,
+	MIN_WORKING_SET = 1 << 12,			//4KB
+	MAX_WORKING_SET = 1 << 28,			//256MB
+	WORKING_SET_ACCESS_COUNT = 1 << 24,
+	CHASE_STEP_COUNT = 1 << 22,
+	FALSE_SHARING_THREAD_COUNT = 4,
+	FALSE_SHARING_INCREMENT_COUNT = 1 << 22,
+	TRANSPOSE_SIZE = 4096,
+	TILE = 64
+};
+
+////////////
+// Report //
+////////////
+struct Record
+{
+	string benchmark;
+	string parameter;
+	double value;
+	string unit;
+};
+
+vector<Record> GRecords;
+
+void AddRecord(const string& benchmark, const string& parameter, double value, const string& unit)
+{
+	GRecords.push_back(Record{ benchmark, parameter, value, unit });
+
+	//오래 걸리니 진행 상황은 stderr로 보여준다. (stdout은 결과만)
+	fprintf(stderr, "%-14s %-18s %14.3f %s\n", benchmark.c_str(), parameter.c_str(), value, unit.c_str());
+}
+
+void PrintCsv()
+{
+	printf("benchmark,parameter,value,unit\n");
+	for (const Record& record : GRecords)
+		printf("%s,%s,%.3f,%s\n", record.benchmark.c_str(), record.parameter.c_str(), record.value, record.unit.c_str());
+}
+
+void PrintJson()
+{
+	printf("[\n");
+	for (size_t i = 0; i < GRecords.size(); i++)
+	{
+		const Record& record = GRecords[i];
+		printf("  {\"benchmark\":\"%s\",\"parameter\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"}%s\n",
+			record.benchmark.c_str(), record.parameter.c_str(), record.value, record.unit.c_str(), i + 1 == GRecords.size() ? "" : ",");
+	}
+	printf("]\n");
+}
+
+string ToSizeText(__int64 bytes)
+{
+	if (bytes >= (1 << 20))
+		return to_string(bytes >> 20) + "MB";
+	if (bytes >= (1 << 10))
+		return to_string(bytes >> 10) + "KB";
+	return to_string(bytes) + "B";
+}
+
+template<typename Func>
+double MeasureMs(Func&& func)
+{
+	auto start = chrono::steady_clock::now();
+	func();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//컴파일러가 결과를 안 쓰는 계산을 지우지 못하게 여기에 쓴다.
+volatile __int64 GSink = 0;
+
+///////////////
+// RowColumn //
+///////////////
+void RunRowColumn()
+{
+	vector<__int32> buffer(static_cast<size_t>(BUFFER_SIZE) * BUFFER_SIZE, 1);
+
+	__int64 rowSum = 0;
+	const double rowElapsed = MeasureMs([&]()
+	{
+		for (__int32 i = 0; i < BUFFER_SIZE; i++)
+			for (__int32 j = 0; j < BUFFER_SIZE; j++)
+				rowSum += buffer[static_cast<size_t>(i) * BUFFER_SIZE + j];
+	});
+
+	//[0][0] 다음에 [1][0]을 읽으면 40000바이트 떨어져 있어서 매번 새 캐시라인을 가져온다.
+	__int64 columnSum = 0;
+	const double columnElapsed = MeasureMs([&]()
+	{
+		for (__int32 j = 0; j < BUFFER_SIZE; j++)
+			for (__int32 i = 0; i < BUFFER_SIZE; i++)
+				columnSum += buffer[static_cast<size_t>(i) * BUFFER_SIZE + j];
+	});
+
+	GSink = rowSum + columnSum;
+	AddRecord("RowColumn", "row-major", rowElapsed, "ms");
+	AddRecord("RowColumn", "column-major", columnElapsed, "ms");
+}
+
+////////////
+// Stride //
+////////////
+void RunStride()
+{
+	vector<char> array(STRIDE_ARRAY_BYTES, 1);
+
+	for (__int64 stride = 4; stride <= 4096; stride *= 2)
+	{
+		//읽는 수는 같게 하고 배열 끝을 넘어가면 처음으로 돌아간다.
+		const __int64 mask = STRIDE_ARRAY_BYTES - 1;
+		__int64 sum = 0;
+		const double elapsed = MeasureMs([&]()
+		{
+			__int64 offset = 0;
+			for (__int32 i = 0; i < STRIDE_ACCESS_COUNT; i++)
+			{
+				sum += array[offset];
+				offset = (offset + stride) & mask;
+			}
+		});
+
+		GSink = sum;
+		AddRecord("Stride", ToSizeText(stride), elapsed * 1e6 / static_cast<double>(STRIDE_ACCESS_COUNT), "ns/access");
+	}
+}
+
+////////////////
+// WorkingSet //
+////////////////
+void RunWorkingSet()
+{
+	vector<char> array(MAX_WORKING_SET, 1);
+
+	for (__int64 size = MIN_WORKING_SET; size <= MAX_WORKING_SET; size *= 2)
+	{
+		const __int64 mask = size - 1;
+		__int64 sum = 0;
+		const double elapsed = MeasureMs([&]()
+		{
+			__int64 offset = 0;
+			for (__int32 i = 0; i < WORKING_SET_ACCESS_COUNT; i++)
+			{
+				sum += array[offset];
+				offset = (offset + CACHE_LINE_SIZE) & mask;
+			}
+		});
+
+		GSink = sum;
+		AddRecord("WorkingSet", ToSizeText(size), elapsed * 1e6 / static_cast<double>(WORKING_SET_ACCESS_COUNT), "ns/access");
+	}
+}
+
+//////////////////
+// PointerChase //
+//////////////////
+//노드 하나가 캐시라인 하나를 차지하게 한다.
+struct alignas(CACHE_LINE_SIZE) ChaseNode
+{
+	ChaseNode* next;
+};
+
+void RunPointerChase()
+{
+	mt19937_64 random(12345);
+
+	for (__int64 size = MIN_WORKING_SET; size <= MAX_WORKING_SET; size *= 2)
+	{
+		const size_t count = static_cast<size_t>(size / sizeof(ChaseNode));
+		vector<ChaseNode> nodes(count);
+
+		//Sattolo 알고리즘으로 모든 노드를 한바퀴에 다 도는 무작위 순서를 만든다.
+		vector<size_t> order(count);
+		iota(order.begin(), order.end(), 0);
+		for (size_t i = count - 1; i > 0; i--)
+			swap(order[i], order[random() % i]);
+		for (size_t i = 0; i < count; i++)
+			nodes[i].next = &nodes[order[i]];
+
+		ChaseNode* node = &nodes[0];
+		const double elapsed = MeasureMs([&]()
+		{
+			for (__int32 i = 0; i < CHASE_STEP_COUNT; i++)
+				node = node->next;
+		});
+
+		GSink = reinterpret_cast<__int64>(node);
+		AddRecord("PointerChase", ToSizeText(size), elapsed * 1e6 / static_cast<double>(CHASE_STEP_COUNT), "ns/load");
+	}
+}
+
+//////////////////
+// FalseSharing //
+//////////////////
+struct PackedCounter
+{
+	atomic<__int64> value = 0;
+};
+
+struct alignas(CACHE_LINE_SIZE) PaddedCounter
+{
+	atomic<__int64> value = 0;
+};
+
+template<typename Counter>
+double RunCounters()
+{
+	Counter counters[FALSE_SHARING_THREAD_COUNT];
+	vector<thread> threads;
+
+	const double elapsed = MeasureMs([&]()
+	{
+		for (__int32 t = 0; t < FALSE_SHARING_THREAD_COUNT; t++)
+		{
+			threads.push_back(thread([&counters, t]()
+			{
+				for (__int32 i = 0; i < FALSE_SHARING_INCREMENT_COUNT; i++)
+					counters[t].value.fetch_add(1, memory_order_relaxed);
+			}));
+		}
+
+		for (thread& t : threads)
+			t.join();
+	});
+
+	return elapsed;
+}
+
+void RunFalseSharing()
+{
+	AddRecord("FalseSharing", "packed", RunCounters<PackedCounter>(), "ms");
+	AddRecord("FalseSharing", "padded", RunCounters<PaddedCounter>(), "ms");
+}
+
+///////////////
+// Transpose //
+///////////////
+void RunTranspose()
+{
+	const size_t n = TRANSPOSE_SIZE;
+	vector<__int32> src(n * n);
+	vector<__int32> naive(n * n);
+	vector<__int32> tiled(n * n);
+	iota(src.begin(), src.end(), 0);
+
+	const double naiveElapsed = MeasureMs([&]()
+	{
+		for (size_t i = 0; i < n; i++)
+			for (size_t j = 0; j < n; j++)
+				naive[j * n + i] = src[i * n + j];
+	});
+
+	//TILE x TILE 블록(64 * 64 * 4바이트 = 16KB) 두개가 L1/L2에 들어가는 동안 블록 안을 다 처리한다.
+	const double tiledElapsed = MeasureMs([&]()
+	{
+		for (size_t ii = 0; ii < n; ii += TILE)
+			for (size_t jj = 0; jj < n; jj += TILE)
+				for (size_t i = ii; i < ii + TILE; i++)
+					for (size_t j = jj; j < jj + TILE; j++)
+						tiled[j * n + i] = src[i * n + j];
+	});
+
+	if (naive != tiled)
+		fprintf(stderr, "!! transpose mismatch\n");
+
+	AddRecord("Transpose", "naive", naiveElapsed, "ms");
+	AddRecord("Transpose", "tiled-" + to_string(TILE), tiledElapsed, "ms");
+}
+
+int main(int argc, char* argv[])
+{
+	const bool json = argc > 1 && strcmp(argv[1], "json") == 0;
+
+	AddRecord("Host", "hardware-threads", thread::hardware_concurrency(), "count");
+	AddRecord("Host", "cache-line", CACHE_LINE_SIZE, "bytes");
+
+	RunRowColumn();
+	RunStride();
+	RunWorkingSet();
+	RunPointerChase();
+	RunFalseSharing();
+	RunTranspose();
+
+	if (json)
+		PrintJson();
+	else
+		PrintCsv();
+}
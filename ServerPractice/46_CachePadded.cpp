@@ -0,0 +1,181 @@
+﻿/*
+	CachePadded.h를 적용하기 전(packed)과 후(padded)의 변수 배치를 나란히 두고 처리량을 비교한다.
+	구조체 전체를 두벌 만들 수는 없으니 문제가 됐던 변수들만 같은 순서로 옮겨왔다.
+	1. LockFreeStack_1 : 14_LockFree_Stack_1의 head, popCount, pendingList
+	2. MemoryPool      : MemoryPool.h의 header, batchHeader, allocCount와 읽기만 하는 allocSize
+	3. LockFreeQueue   : LockFreeQueue.h의 head, tail
+
+	변수마다 그 변수를 고치는 역할(스레드)을 하나씩 두고 실제 코드에서 하는 연산(CAS, fetch_add, exchange, 읽기)을 OPERATION_COUNT번 한다.
+	스레드끼리 같은 변수를 건드리지 않으니 packed에서 느려지는 만큼이 전부 False Sharing 때문이다.
+	코어가 하나뿐이면 스레드들이 번갈아 돌 뿐 캐시라인을 두고 싸우지 않아서 차이가 나지 않는다.
+*/
+
+#include "CachePadded.h"
+#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum
+{
+	OPERATION_COUNT = 1 << 22		//스레드 하나가 하는 연산 수
+};
+
+//CachePadded를 적용하기 전
+template<typename T>
+using Packed = T;
+
+/////////////////////
+// LockFreeStack_1 //
+/////////////////////
+template<template<typename> class Wrap>
+struct StackLayout
+{
+	enum { ROLE_COUNT = 3 };
+
+	Wrap<atomic<__int64>> head;
+	Wrap<atomic<__int32>> popCount;
+	Wrap<atomic<__int64>> pendingList;
+
+	void Work(__int32 role, __int64 i)
+	{
+		switch (role)
+		{
+		case 0:
+		{
+			//Push : head를 CAS로 바꾼다.
+			__int64 expected = head.load(memory_order_relaxed);
+			while (head.compare_exchange_weak(expected, expected + 1) == false)
+			{
+			}
+			break;
+		}
+		case 1:
+			//TryPop : 들어오고 나갈 때 popCount를 올리고 내린다.
+			popCount.fetch_add(1);
+			popCount.fetch_sub(1);
+			break;
+		case 2:
+			//TryDelete : 혼자일 때 pendingList를 통째로 떼어간다.
+			pendingList.exchange(i);
+			break;
+		}
+	}
+};
+
+////////////////
+// MemoryPool //
+////////////////
+template<template<typename> class Wrap>
+struct PoolLayout
+{
+	enum { ROLE_COUNT = 4 };
+
+	Wrap<atomic<__int64>> header;
+	Wrap<atomic<__int64>> batchHeader;
+	Wrap<atomic<__int32>> allocCount;
+	__int32 allocSize = 64;
+
+	__int64 readSum = 0;
+
+	void Work(__int32 role, __int64)
+	{
+		switch (role)
+		{
+		case 0:
+		{
+			//낱개 Push/Pop : header를 CAS로 바꾼다.
+			__int64 expected = header.load(memory_order_relaxed);
+			while (header.compare_exchange_weak(expected, expected + 1) == false)
+			{
+			}
+			break;
+		}
+		case 1:
+		{
+			//묶음 Push/Pop : batchHeader를 CAS로 바꾼다.
+			__int64 expected = batchHeader.load(memory_order_relaxed);
+			while (batchHeader.compare_exchange_weak(expected, expected + 1) == false)
+			{
+			}
+			break;
+		}
+		case 2:
+			allocCount.fetch_add(1);
+			break;
+		case 3:
+			//Slab을 쪼갤 때처럼 allocSize를 읽기만 한다. (volatile로 매번 메모리에서 읽게 한다)
+			readSum += *static_cast<volatile __int32*>(&allocSize);
+			break;
+		}
+	}
+};
+
+///////////////////
+// LockFreeQueue //
+///////////////////
+template<template<typename> class Wrap>
+struct QueueLayout
+{
+	enum { ROLE_COUNT = 2 };
+
+	Wrap<atomic<__int64>> head;
+	Wrap<atomic<__int64>> tail;
+
+	void Work(__int32 role, __int64)
+	{
+		//넣는 쪽은 tail만, 빼는 쪽은 head만 CAS 한다.
+		atomic<__int64>& target = role == 0 ? static_cast<atomic<__int64>&>(tail) : static_cast<atomic<__int64>&>(head);
+		__int64 expected = target.load(memory_order_relaxed);
+		while (target.compare_exchange_weak(expected, expected + 1) == false)
+		{
+		}
+	}
+};
+
+//역할마다 스레드 하나씩. 전체 연산 수 / 걸린 시간 (Mops/s)
+template<typename Layout>
+double Run()
+{
+	Layout* layout = new Layout();
+	vector<thread> threads;
+
+	auto start = chrono::steady_clock::now();
+	for (__int32 role = 0; role < Layout::ROLE_COUNT; role++)
+	{
+		threads.push_back(thread([layout, role]()
+		{
+			for (__int64 i = 0; i < OPERATION_COUNT; i++)
+				layout->Work(role, i);
+		}));
+	}
+
+	for (thread& t : threads)
+		t.join();
+	chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+
+	delete layout;
+	return static_cast<double>(Layout::ROLE_COUNT) * static_cast<double>(OPERATION_COUNT) / elapsed.count();
+}
+
+template<template<template<typename> class> class Layout>
+void Compare(const char* name)
+{
+	const double packed = Run<Layout<Packed>>();
+	const double padded = Run<Layout<CachePadded>>();
+
+	printf("%-16s %5zu B %5zu B %11.2f %11.2f %7.2fx\n", name, sizeof(Layout<Packed>), sizeof(Layout<CachePadded>), packed, padded, padded / packed);
+}
+
+int main()
+{
+	printf("hardware threads %u, CACHE_PADDED_ALIGNMENT %d\n", thread::hardware_concurrency(), static_cast<__int32>(CACHE_PADDED_ALIGNMENT));
+	printf("%-16s %7s %7s %11s %11s %8s\n", "layout", "packed", "padded", "packed", "padded", "(Mops/s)");
+
+	Compare<StackLayout>("LockFreeStack_1");
+	Compare<PoolLayout>("MemoryPool");
+	Compare<QueueLayout>("LockFreeQueue");
+}
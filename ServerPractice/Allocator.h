@@ -0,0 +1,372 @@
+﻿#pragma once
+
+/*
+	19_Allocator, 20_StompAllocator에서는 xnew/xdelete가 파일마다 BaseAllocator나 StompAllocator로 고정되어 있었다.
+	이제는 메모리 풀(Memory.h)이 생겼으니 xnew/xdelete도 메모리 풀을 쓰게 한다.
+	21_STLAllocator의 STLAllocator도 StompAllocator로 고정되어 있었는데
+	StompAllocator는 원소 하나를 넣을 때마다 최소 한 페이지를 할당받기 때문에 디버깅용이 아니면 쓸 수가 없다.
+	그래서 어떤 Allocator를 쓸지 템플릿 인자(Policy)로 받게 바꿨다.
+*/
+
+#include "Memory.h"
+#include <utility>
+
+#include <mutex>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+////////////////////
+// Base Allocator //
+////////////////////
+class BaseAllocator
+{
+public:
+	static void* Alloc(__int32 size)
+	{
+		return malloc(size);
+	}
+	static void Release(void* ptr)
+	{
+		free(ptr);
+	}
+};
+
+////////////////////
+// Pool Allocator //
+////////////////////
+class PoolAllocator
+{
+public:
+	static void* Alloc(__int32 size)
+	{
+		return GMemory.Allocate(size);
+	}
+	static void Release(void* ptr)
+	{
+		GMemory.Release(ptr);
+	}
+};
+
+/////////////////////
+// Stomp Allocator //
+/////////////////////
+/*
+	20_StompAllocator의 StompAllocator는 VirtualAlloc/VirtualFree를 써서 윈도우에서만 쓸 수 있었다.
+	리눅스에서는 mmap/mprotect/munmap으로 똑같은 일을 한다.
+	할당 하나는 이렇게 생겼다.
+
+	[    ...    ][StompHeader][Data][Guard Page]
+
+	데이터를 페이지의 맨 끝에 붙이는 것은 20번과 같다.
+	그 뒤에 접근 금지 페이지(Guard Page)를 하나 더 둬서 바로 뒤에 다른 할당이 붙어있더라도
+	끝을 넘어서 읽고 쓰는 순간 터지게 했다.
+
+	1. Quarantine
+	   해제한 메모리를 바로 운영체제에 돌려주면 그 주소가 다른 할당에 재사용되어서 Use-After-Free가 안 터질 수 있다.
+	   그래서 해제한 메모리는 접근 금지로만 바꿔두고 QUARANTINE_COUNT번의 해제가 더 일어난 다음에 돌려준다.
+	   돌려줄 때는 RELEASE_BATCH_COUNT개씩 모아서 주소순으로 정렬한 다음 붙어있는 것끼리 합쳐서 한번에 돌려준다.
+	2. Arena
+	   할당마다 주소 공간을 새로 받아오면 부하 테스트를 돌릴 때 시간 대부분을 시스템 콜에 쓰게 된다.
+	   그래서 ARENA_SIZE만큼 주소 공간을 한번에 예약(접근 금지)해두고 앞에서부터 잘라 쓴다.
+	   할당마다 하는 시스템 콜은 필요한 페이지만 읽고 쓸 수 있게 바꾸는 한번뿐이다.
+
+	리눅스에서는 Guard Page 때문에 할당 하나가 매핑(VMA)을 2개씩 차지한다.
+	매핑 수는 vm.max_map_count(기본 65530)로 제한되어 있으니 살아있는 할당이 수만개를 넘는 테스트라면 이 값을 올려줘야 한다.
+*/
+class StompAllocator
+{
+public:
+	enum
+	{
+		ARENA_SIZE = 64 * 1024 * 1024,	//주소 공간을 한번에 예약하는 단위 (64MB)
+		QUARANTINE_COUNT = 1024,		//해제한 메모리를 접근 금지로 잡아두는 개수 (0이면 바로 돌려준다)
+		RELEASE_BATCH_COUNT = 64,		//Quarantine에서 한번에 꺼내서 돌려주는 개수
+		STOMP_MAGIC = 0x53544F4D		//"STOM"
+	};
+
+	static void* Alloc(__int32 size)
+	{
+		const __int64 pageSize = GetPageSize();
+
+		//데이터 앞에 헤더가 들어갈 자리까지 포함해서 페이지 단위로 올림한다.
+		const __int64 pageCount = (size + static_cast<__int64>(sizeof(StompHeader)) + pageSize - 1) / pageSize;
+		const __int64 dataOffset = pageCount * pageSize - size;
+
+		__int8* arenaBase = nullptr;
+		__int8* baseAddress = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(stompLock);
+			baseAddress = ReserveFromArena((pageCount + 1) * pageSize, &arenaBase);
+		}
+
+		//Guard Page는 예약만 해둔 상태(접근 금지) 그대로 둔다.
+		CommitPages(baseAddress, pageCount * pageSize);
+
+		void* data = baseAddress + dataOffset;
+		StompHeader* header = HeaderOf(data);
+		header->arenaBase = arenaBase;
+		header->baseAddress = baseAddress;
+		header->pageCount = pageCount;
+		header->magic = STOMP_MAGIC;
+
+		return data;
+	}
+
+	static void Release(void* ptr)
+	{
+		if (ptr == nullptr)
+			return;
+
+		//헤더가 망가져 있으면 데이터의 앞쪽을 넘어서 썼다는 뜻이다.
+		//이미 해제한 메모리라면 헤더를 읽는 순간 접근 금지 페이지라서 터진다.
+		StompHeader* header = HeaderOf(ptr);
+		ASSERT_CRASH(header->magic == STOMP_MAGIC);
+
+		const QuarantineEntry entry = { header->arenaBase, header->baseAddress, (header->pageCount + 1) * GetPageSize() };
+
+		if (QUARANTINE_COUNT == 0)
+		{
+			ReleasePages(entry.baseAddress, entry.size);
+			return;
+		}
+
+		ProtectPages(entry.baseAddress, entry.size);
+
+		QuarantineEntry evicted[RELEASE_BATCH_COUNT];
+		__int32 evictCount = 0;
+		{
+			std::lock_guard<std::mutex> lock(stompLock);
+			quarantine[(quarantineHead + quarantineCount) % QUARANTINE_SLOT_COUNT] = entry;
+			quarantineCount++;
+
+			//꽉 찼으면 제일 오래된 것부터 RELEASE_BATCH_COUNT개를 꺼낸다.
+			if (quarantineCount == QUARANTINE_SLOT_COUNT)
+			{
+				for (; evictCount < RELEASE_BATCH_COUNT; evictCount++)
+					evicted[evictCount] = quarantine[(quarantineHead + evictCount) % QUARANTINE_SLOT_COUNT];
+
+				quarantineHead = (quarantineHead + RELEASE_BATCH_COUNT) % QUARANTINE_SLOT_COUNT;
+				quarantineCount -= RELEASE_BATCH_COUNT;
+			}
+		}
+
+		if (evictCount > 0)
+			ReleaseQuarantined(evicted, evictCount);
+	}
+
+private:
+	enum { QUARANTINE_SLOT_COUNT = QUARANTINE_COUNT + RELEASE_BATCH_COUNT };
+
+	struct StompHeader
+	{
+		__int8* arenaBase;
+		__int8* baseAddress;
+		__int64 pageCount;
+		__int32 magic;
+	};
+
+	struct QuarantineEntry
+	{
+		__int8* arenaBase;		//같은 Arena 안에서 붙어있는 것끼리만 합칠 수 있다.
+		__int8* baseAddress;
+		__int64 size;
+	};
+
+	//데이터가 페이지 끝에 딱 붙어있기 때문에 데이터 주소는 정렬이 안되어 있을 수 있다.
+	//헤더는 데이터 바로 앞에서 8바이트 단위로 내림한 자리에 둔다.
+	static StompHeader* HeaderOf(void* data)
+	{
+		const unsigned __int64 address = reinterpret_cast<unsigned __int64>(data) - sizeof(StompHeader);
+		return reinterpret_cast<StompHeader*>(address & ~static_cast<unsigned __int64>(alignof(StompHeader) - 1));
+	}
+
+	//할당은 Arena 앞에서부터 순서대로 잘라가기 때문에 비슷한 시기에 할당된 것들은 주소도 붙어있다.
+	//그래서 정렬해서 합치면 시스템 콜 횟수가 많이 줄어든다.
+	static void ReleaseQuarantined(QuarantineEntry* entries, __int32 count)
+	{
+		std::sort(entries, entries + count, [](const QuarantineEntry& left, const QuarantineEntry& right)
+		{
+			return left.baseAddress < right.baseAddress;
+		});
+
+		QuarantineEntry merged = entries[0];
+		for (__int32 i = 1; i < count; i++)
+		{
+			if (entries[i].arenaBase == merged.arenaBase && entries[i].baseAddress == merged.baseAddress + merged.size)
+			{
+				merged.size += entries[i].size;
+				continue;
+			}
+
+			ReleasePages(merged.baseAddress, merged.size);
+			merged = entries[i];
+		}
+		ReleasePages(merged.baseAddress, merged.size);
+	}
+
+	//stompLock을 잡은 상태에서 호출해야 한다.
+	static __int8* ReserveFromArena(__int64 size, __int8** arenaBase)
+	{
+		//Arena보다 큰 할당은 따로 예약한다.
+		if (size > ARENA_SIZE)
+		{
+			*arenaBase = ReserveAddressSpace(size);
+			return *arenaBase;
+		}
+
+		if (arenaCursor == nullptr || arenaEnd - arenaCursor < size)
+		{
+			//남은 자투리는 예약만 되어있는 상태라 실제 메모리를 차지하지 않으니 그냥 버린다.
+			arenaStart = ReserveAddressSpace(ARENA_SIZE);
+			arenaCursor = arenaStart;
+			arenaEnd = arenaCursor + ARENA_SIZE;
+		}
+
+		*arenaBase = arenaStart;
+		__int8* baseAddress = arenaCursor;
+		arenaCursor += size;
+		return baseAddress;
+	}
+
+#if defined(_WIN32)
+	static __int64 GetPageSize()
+	{
+		static const __int64 pageSize = []()
+		{
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			return static_cast<__int64>(info.dwPageSize);
+		}();
+		return pageSize;
+	}
+
+	static __int8* ReserveAddressSpace(__int64 size)
+	{
+		void* address = ::VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+		ASSERT_CRASH(address != NULL);
+		return static_cast<__int8*>(address);
+	}
+
+	static void CommitPages(__int8* address, __int64 size)
+	{
+		void* committed = ::VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE);
+		ASSERT_CRASH(committed != NULL);
+	}
+
+	static void ProtectPages(__int8* address, __int64 size)
+	{
+		DWORD oldProtect;
+		::VirtualProtect(address, size, PAGE_NOACCESS, &oldProtect);
+	}
+
+	//예약의 일부만 MEM_RELEASE할 수는 없기 때문에 Decommit만 한다.
+	//주소 공간은 예약된 채로 남아서 다른 할당이 그 주소를 다시 받아가는 일이 없다.
+	static void ReleasePages(__int8* address, __int64 size)
+	{
+		::VirtualFree(address, size, MEM_DECOMMIT);
+	}
+#else
+	static __int64 GetPageSize()
+	{
+		static const __int64 pageSize = static_cast<__int64>(::sysconf(_SC_PAGESIZE));
+		return pageSize;
+	}
+
+	static __int8* ReserveAddressSpace(__int64 size)
+	{
+		void* address = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		ASSERT_CRASH(address != MAP_FAILED);
+		return static_cast<__int8*>(address);
+	}
+
+	static void CommitPages(__int8* address, __int64 size)
+	{
+		const int result = ::mprotect(address, size, PROT_READ | PROT_WRITE);
+		ASSERT_CRASH(result == 0);
+	}
+
+	static void ProtectPages(__int8* address, __int64 size)
+	{
+		::mprotect(address, size, PROT_NONE);
+	}
+
+	//munmap은 예약된 범위의 일부만 돌려줄 수 있다.
+	static void ReleasePages(__int8* address, __int64 size)
+	{
+		::munmap(address, size);
+	}
+#endif
+
+	static inline std::mutex stompLock;
+	static inline __int8* arenaStart = nullptr;
+	static inline __int8* arenaCursor = nullptr;
+	static inline __int8* arenaEnd = nullptr;
+	static inline QuarantineEntry quarantine[QUARANTINE_SLOT_COUNT];
+	static inline __int32 quarantineHead = 0;
+	static inline __int32 quarantineCount = 0;
+};
+
+//디버그 빌드에서는 메모리 오염을 잡기 위해 StompAllocator를, 릴리즈 빌드에서는 메모리 풀을 쓴다.
+#if defined(_DEBUG)
+using DefaultAllocator = StompAllocator;
+#else
+using DefaultAllocator = PoolAllocator;
+#endif
+
+///////////////////
+// STL Allocator //
+///////////////////
+template<typename T, typename Policy = DefaultAllocator>
+class STLAllocator
+{
+public:
+	using value_type = T;
+
+	STLAllocator() {}
+	template<typename Other>
+	STLAllocator(const STLAllocator<Other, Policy>&) {}
+
+	T* allocate(size_t count)
+	{
+		const __int32 size = static_cast<__int32>(count * sizeof(T));
+		return static_cast<T*>(Policy::Alloc(size));
+	}
+
+	//Policy::Release는 포인터만으로 해제하기 때문에 count는 쓰지 않는다.
+	void deallocate(T* ptr, size_t /*count*/)
+	{
+		Policy::Release(ptr);
+	}
+
+	//Policy가 같으면 어느 STLAllocator로 할당했든 서로 해제할 수 있다.
+	template<typename Other>
+	bool operator==(const STLAllocator<Other, Policy>&) const { return true; }
+	template<typename Other>
+	bool operator!=(const STLAllocator<Other, Policy>&) const { return false; }
+};
+
+////////////
+// Memory //
+////////////
+template<typename Type, typename... Args>
+Type* xnew(Args&&... args)
+{
+	Type* memory = static_cast<Type*>(PoolAllocator::Alloc(sizeof(Type)));
+
+	new(memory)Type(std::forward<Args>(args)...);
+
+	return memory;
+}
+
+template<typename Type>
+void xdelete(Type* obj)
+{
+	obj->~Type();
+	PoolAllocator::Release(obj);
+}
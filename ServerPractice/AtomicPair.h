@@ -0,0 +1,278 @@
+﻿#pragma once
+
+/*
+	15_LockFree_Stack_2는 std::atomic<CountedNodePtr>, 23_MemoryPool2는 InterlockedCompareExchange128로 16바이트 CAS(DWCAS)를 한다.
+	그런데 둘 다 정말 lock free인지는 운에 맡겨져 있다.
+	1. InterlockedCompareExchange128은 MSVC에만 있다.
+	2. gcc의 std::atomic<16바이트>는 libatomic을 부르는데 CPU에 따라 안에서 lock을 잡을 수도 있고
+	   is_always_lock_free도 false로 나온다. (-mcx16을 줘도 마찬가지다)
+
+	AtomicPair는 16바이트 CAS를 컴파일러/플랫폼마다 확실히 lock free인 방법으로만 한다.
+	1. MSVC x64       : _InterlockedCompareExchange128
+	2. gcc/clang      : __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16이 정의되어 있으면 (x86-64에 -mcx16, aarch64 등)
+	                    __sync 빌트인. 이 매크로가 있으면 라이브러리 호출 없이 명령어로 바로 만들어진다.
+	3. gcc/clang x86-64 : 위 매크로가 없으면 cmpxchg16b 명령어를 직접 쓴다.
+	셋 다 아니면 ATOMIC_PAIR_LOCK_FREE가 0이 되고 AtomicPair는 없다.
+
+	AtomicTaggedPtr<T>는 (포인터, tag)를 한번에 CAS 한다. ABA를 막는 sequence나 참조 카운트를 tag에 넣는다.
+	DWCAS가 있으면 AtomicPair에 tag 64비트를 그대로 넣고
+	없으면 포인터 48비트 + tag 16비트를 8바이트 하나에 넣어서 std::atomic<unsigned __int64>로 CAS 한다.
+	(x86-64와 aarch64의 유저 영역 주소는 48비트 안에 들어간다. 대신 tag가 65536번마다 한바퀴 돌아서 ABA를 막는 힘은 약해진다)
+	테스트 할 때는 ATOMIC_PAIR_DISABLE_DWCAS를 정의하면 DWCAS가 있어도 48 + 16비트 방식으로 빌드된다.
+*/
+
+#include "Types.h"
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(ATOMIC_PAIR_DISABLE_DWCAS)
+#define ATOMIC_PAIR_LOCK_FREE 0
+#define ATOMIC_PAIR_BACKEND "none (pointer 48 + tag 16)"
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define ATOMIC_PAIR_LOCK_FREE 1
+#define ATOMIC_PAIR_MSVC
+#define ATOMIC_PAIR_BACKEND "_InterlockedCompareExchange128"
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#define ATOMIC_PAIR_LOCK_FREE 1
+#define ATOMIC_PAIR_BUILTIN
+#define ATOMIC_PAIR_BACKEND "__sync_val_compare_and_swap (16 bytes)"
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define ATOMIC_PAIR_LOCK_FREE 1
+#define ATOMIC_PAIR_CMPXCHG16B
+#define ATOMIC_PAIR_BACKEND "cmpxchg16b"
+#else
+#define ATOMIC_PAIR_LOCK_FREE 0
+#define ATOMIC_PAIR_BACKEND "none (pointer 48 + tag 16)"
+#endif
+
+#if ATOMIC_PAIR_LOCK_FREE
+
+////////////////
+// AtomicPair //
+////////////////
+//8바이트 두개(low, high)를 한번에 CAS 한다. cmpxchg16b는 16바이트로 정렬된 주소에만 쓸 수 있다.
+class alignas(16) AtomicPair
+{
+public:
+	struct Value
+	{
+		unsigned __int64 low = 0;
+		unsigned __int64 high = 0;
+	};
+
+	//어떤 백엔드든 명령어 하나로 끝나는 것만 골랐다. (lock을 잡는 libatomic으로 빠지는 경우는 위에서 걸렀다)
+	static constexpr bool IS_ALWAYS_LOCK_FREE = true;
+
+	AtomicPair() = default;
+	AtomicPair(Value value) { Store(value); }
+
+	AtomicPair(const AtomicPair&) = delete;
+	AtomicPair& operator=(const AtomicPair&) = delete;
+
+	/*
+		같으면 desired로 바꾸고 true, 다르면 지금 값을 expected에 넣고 false를 리턴한다. (std::atomic과 같다)
+		expected는 실패했을 때만 고친다. 성공했을 때도 쓰면 expected가 방금 올린 노드의 next 같은 곳일 때
+		그 사이 다른 스레드가 지운 노드에 쓰게 된다. (LockFreeStack<T, SplitRefCount>에서 실제로 있었던 문제)
+		seq_cst다. (x86의 lock cmpxchg16b는 원래 전체 배리어다)
+	*/
+	bool CompareExchange(Value& expected, Value desired)
+	{
+#if defined(ATOMIC_PAIR_MSVC)
+		__int64 comparand[2] = { static_cast<__int64>(expected.low), static_cast<__int64>(expected.high) };
+		if (::_InterlockedCompareExchange128(words, static_cast<__int64>(desired.high), static_cast<__int64>(desired.low), comparand) == 1)
+			return true;
+
+		expected.low = static_cast<unsigned __int64>(comparand[0]);
+		expected.high = static_cast<unsigned __int64>(comparand[1]);
+		return false;
+#elif defined(ATOMIC_PAIR_BUILTIN)
+		const unsigned __int128 comparand = ToBits(expected);
+		const unsigned __int128 previous = __sync_val_compare_and_swap(&bits, comparand, ToBits(desired));
+		if (previous == comparand)
+			return true;
+
+		expected.low = static_cast<unsigned __int64>(previous);
+		expected.high = static_cast<unsigned __int64>(previous >> 64);
+		return false;
+#else
+		//cmpxchg16b는 RDX:RAX와 메모리의 값을 비교해서 같으면 RCX:RBX를 메모리에 써준다.
+		//다르면 메모리의 값을 RDX:RAX로 읽어온다.
+		unsigned __int64 low = expected.low;
+		unsigned __int64 high = expected.high;
+		bool result;
+		__asm__ __volatile__(
+			"lock cmpxchg16b %1"
+			: "=@ccz"(result), "+m"(words), "+a"(low), "+d"(high)
+			: "b"(desired.low), "c"(desired.high)
+			: "memory");
+
+		if (result)
+			return true;
+
+		expected.low = low;
+		expected.high = high;
+		return false;
+#endif
+	}
+
+	//같은 값으로 CAS를 해서 16바이트를 한번에 읽는다. 읽기만 해도 캐시라인을 독점하니 자주 부르지 않는다.
+	Value Load()
+	{
+		Value value;
+		CompareExchange(value, value);
+		return value;
+	}
+
+	//8바이트씩 따로 읽어서 두 값이 섞여 있을 수 있다. CAS 루프의 첫 expected로만 쓴다. (틀리면 CAS가 고쳐준다)
+	Value LoadRelaxed() const
+	{
+#if defined(ATOMIC_PAIR_BUILTIN)
+		const unsigned __int128 value = bits;
+		return Value{ static_cast<unsigned __int64>(value), static_cast<unsigned __int64>(value >> 64) };
+#else
+		return Value{ static_cast<unsigned __int64>(words[0]), static_cast<unsigned __int64>(words[1]) };
+#endif
+	}
+
+	void Store(Value desired)
+	{
+		Value expected = LoadRelaxed();
+		while (CompareExchange(expected, desired) == false)
+		{
+		}
+	}
+
+private:
+#if defined(ATOMIC_PAIR_BUILTIN)
+	static unsigned __int128 ToBits(Value value)
+	{
+		return (static_cast<unsigned __int128>(value.high) << 64) | value.low;
+	}
+
+	volatile unsigned __int128 bits = 0;
+#else
+	//[0]이 low, [1]이 high
+	volatile __int64 words[2] = {};
+#endif
+};
+
+static_assert(sizeof(AtomicPair) == 16 && alignof(AtomicPair) == 16, "AtomicPair는 16바이트로 정렬된 16바이트여야 한다.");
+
+#endif
+
+///////////////
+// TaggedPtr //
+///////////////
+template<typename T>
+struct TaggedPtr
+{
+	T* ptr = nullptr;
+	unsigned __int64 tag = 0;
+};
+
+/////////////////////
+// AtomicTaggedPtr //
+/////////////////////
+template<typename T>
+class AtomicTaggedPtr
+{
+public:
+	enum
+	{
+#if ATOMIC_PAIR_LOCK_FREE
+		TAG_BITS = 64
+#else
+		TAG_BITS = 16,
+		POINTER_BITS = 48
+#endif
+	};
+
+	AtomicTaggedPtr() = default;
+	AtomicTaggedPtr(const AtomicTaggedPtr&) = delete;
+	AtomicTaggedPtr& operator=(const AtomicTaggedPtr&) = delete;
+
+	//AtomicPair::CompareExchange와 같다. tag는 TAG_BITS만큼만 비교하고 저장한다.
+	bool CompareExchange(TaggedPtr<T>& expected, const TaggedPtr<T>& desired)
+	{
+#if ATOMIC_PAIR_LOCK_FREE
+		AtomicPair::Value comparand = ToValue(expected);
+		if (pair.CompareExchange(comparand, ToValue(desired)))
+			return true;
+
+		expected = FromValue(comparand);
+		return false;
+#else
+		unsigned __int64 comparand = Pack(expected);
+		if (bits.compare_exchange_strong(comparand, Pack(desired)))
+			return true;
+
+		expected = Unpack(comparand);
+		return false;
+#endif
+	}
+
+	TaggedPtr<T> Load()
+	{
+#if ATOMIC_PAIR_LOCK_FREE
+		return FromValue(pair.Load());
+#else
+		return Unpack(bits.load());
+#endif
+	}
+
+	//CAS 루프의 첫 expected로만 쓴다. (AtomicPair::LoadRelaxed 참고)
+	TaggedPtr<T> LoadRelaxed() const
+	{
+#if ATOMIC_PAIR_LOCK_FREE
+		return FromValue(pair.LoadRelaxed());
+#else
+		return Unpack(bits.load(std::memory_order_relaxed));
+#endif
+	}
+
+	void Store(const TaggedPtr<T>& desired)
+	{
+#if ATOMIC_PAIR_LOCK_FREE
+		pair.Store(ToValue(desired));
+#else
+		bits.store(Pack(desired));
+#endif
+	}
+
+private:
+#if ATOMIC_PAIR_LOCK_FREE
+	//low가 tag, high가 포인터 (15_LockFree_Stack_2의 CountedNodePtr, 23_MemoryPool2의 SListHeader와 같은 순서)
+	static AtomicPair::Value ToValue(const TaggedPtr<T>& value)
+	{
+		return AtomicPair::Value{ value.tag, reinterpret_cast<unsigned __int64>(value.ptr) };
+	}
+
+	static TaggedPtr<T> FromValue(const AtomicPair::Value& value)
+	{
+		return TaggedPtr<T>{ reinterpret_cast<T*>(value.high), value.low };
+	}
+
+	AtomicPair pair;
+#else
+	static constexpr unsigned __int64 POINTER_MASK = (1ull << POINTER_BITS) - 1;
+
+	static unsigned __int64 Pack(const TaggedPtr<T>& value)
+	{
+		return (value.tag << POINTER_BITS) | (reinterpret_cast<unsigned __int64>(value.ptr) & POINTER_MASK);
+	}
+
+	//47번 비트를 위로 채워서 원래 주소로 되돌린다. (커널 영역처럼 위쪽 비트가 1인 주소도 그대로 돌아온다)
+	static TaggedPtr<T> Unpack(unsigned __int64 bits)
+	{
+		const __int64 address = static_cast<__int64>(bits << (64 - POINTER_BITS)) >> (64 - POINTER_BITS);
+		return TaggedPtr<T>{ reinterpret_cast<T*>(address), bits >> POINTER_BITS };
+	}
+
+	static_assert(std::atomic<unsigned __int64>::is_always_lock_free, "포인터 + tag를 넣을 8바이트 CAS가 lock free여야 한다.");
+
+	std::atomic<unsigned __int64> bits = 0;
+#endif
+};
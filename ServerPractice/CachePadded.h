@@ -0,0 +1,54 @@
+﻿#pragma once
+
+/*
+	09_Cache, 45_CacheBenchmark에서 봤듯이 캐시는 캐시라인 단위로 움직인다.
+	서로 다른 스레드가 쓰는 변수 두개가 한 캐시라인에 있으면 각자 자기 변수만 건드려도 캐시라인을 계속 뺏고 뺏긴다. (False Sharing)
+	지금까지는 멤버마다 alignas(CACHE_LINE_SIZE)를 붙이고 마지막에 padding 변수를 둬서 떨어뜨렸다. (LockFreeQueue, MPMCQueue)
+
+	CachePadded<T>는 T 하나가 캐시라인을 혼자 쓰게 감싼다.
+	1. alignas로 시작 주소를 캐시라인에 맞추고, 크기도 정렬 단위의 배수로 올라가서 뒤에 오는 변수가 같은 캐시라인에 들어오지 않는다.
+	2. T를 상속하기 때문에 atomic<int>를 감싸도 ++, load, compare_exchange_weak 등을 그대로 쓸 수 있다. (그래서 T는 클래스여야 한다)
+
+	정렬 단위는 표준의 std::hardware_destructive_interference_size(false sharing을 피하려면 떨어뜨려야 하는 거리)를 쓰고
+	없는 컴파일러에서는 Types.h의 CACHE_LINE_SIZE를 쓴다.
+	gcc는 이 값이 -mtune에 따라 바뀔 수 있다고 경고(-Winterference-size)하는데 여기서는 구조체 배치에만 쓰니 끈다.
+*/
+
+#include "Types.h"
+#include <new>
+#include <type_traits>
+
+#if defined(__cpp_lib_hardware_interference_size)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+enum
+{
+	CACHE_PADDED_ALIGNMENT = std::hardware_destructive_interference_size
+};
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+enum
+{
+	CACHE_PADDED_ALIGNMENT = CACHE_LINE_SIZE
+};
+#endif
+
+/////////////////
+// CachePadded //
+/////////////////
+template<typename T>
+struct alignas(CACHE_PADDED_ALIGNMENT) CachePadded : public T
+{
+	static_assert(std::is_class_v<T>, "CachePadded는 T를 상속하기 때문에 클래스만 감쌀 수 있다. (int 대신 atomic<int>)");
+	static_assert(alignof(T) <= CACHE_PADDED_ALIGNMENT, "T의 정렬이 캐시라인보다 크다.");
+
+	//T의 생성자와 대입 연산자를 그대로 쓴다. (CachePadded<std::atomic<__int32>> count = 0;)
+	using T::T;
+	using T::operator=;
+
+	CachePadded() = default;
+};
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+/*
+	STL 컨테이너들이 new/delete 대신 STLAllocator(Allocator.h)를 쓰도록 이름을 새로 붙여준다.
+	특히 map, list, unordered_map처럼 노드 기반인 컨테이너는 원소를 하나 넣을 때마다 노드를 하나씩 할당하기 때문에
+	이걸 메모리 풀로 돌리는 것 만으로도 전역 힙에 가는 횟수가 확 줄어든다.
+*/
+
+#include "Allocator.h"
+#include <vector>
+#include <list>
+#include <deque>
+#include <queue>
+#include <stack>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <string>
+#include <string_view>
+
+template<typename Type>
+using xvector = std::vector<Type, STLAllocator<Type>>;
+
+template<typename Type>
+using xlist = std::list<Type, STLAllocator<Type>>;
+
+template<typename Type>
+using xdeque = std::deque<Type, STLAllocator<Type>>;
+
+template<typename Type, typename Container = xdeque<Type>>
+using xqueue = std::queue<Type, Container>;
+
+template<typename Type, typename Container = xdeque<Type>>
+using xstack = std::stack<Type, Container>;
+
+template<typename Type, typename Container = xvector<Type>, typename Pred = std::less<typename Container::value_type>>
+using xpriority_queue = std::priority_queue<Type, Container, Pred>;
+
+template<typename Key, typename Type, typename Pred = std::less<Key>>
+using xmap = std::map<Key, Type, Pred, STLAllocator<std::pair<const Key, Type>>>;
+
+template<typename Key, typename Pred = std::less<Key>>
+using xset = std::set<Key, Pred, STLAllocator<Key>>;
+
+template<typename Key, typename Type, typename Hasher = std::hash<Key>, typename KeyEq = std::equal_to<Key>>
+using xunordered_map = std::unordered_map<Key, Type, Hasher, KeyEq, STLAllocator<std::pair<const Key, Type>>>;
+
+template<typename Key, typename Hasher = std::hash<Key>, typename KeyEq = std::equal_to<Key>>
+using xunordered_set = std::unordered_set<Key, Hasher, KeyEq, STLAllocator<Key>>;
+
+using xstring = std::basic_string<char, std::char_traits<char>, STLAllocator<char>>;
+
+using xwstring = std::basic_string<wchar_t, std::char_traits<wchar_t>, STLAllocator<wchar_t>>;
+
+//std::hash는 기본 Allocator를 쓰는 string만 지원하기 때문에 xstring을 unordered_map의 키로 쓰려면 직접 만들어줘야 한다.
+template<>
+struct std::hash<xstring>
+{
+	size_t operator()(const xstring& str) const noexcept
+	{
+		return std::hash<std::string_view>()(std::string_view(str.data(), str.size()));
+	}
+};
+
+template<>
+struct std::hash<xwstring>
+{
+	size_t operator()(const xwstring& str) const noexcept
+	{
+		return std::hash<std::wstring_view>()(std::wstring_view(str.data(), str.size()));
+	}
+};
@@ -0,0 +1,493 @@
+﻿#pragma once
+
+/*
+	Future(Future.h)의 Then으로 단계를 이으면 스레드는 막히지 않지만 코드가 람다 안의 람다로 쪼개진다.
+	C++20 코루틴을 쓰면 co_await에서 멈췄다가 값이 오면 그 자리부터 이어서 하기 때문에 평범한 함수처럼 위에서 아래로 쓸 수 있다.
+	멈춰있는 동안에는 스레드를 붙잡고 있지 않는다. (지역 변수는 코루틴 프레임에 들어있다)
+
+	1. Task<T>      : co_return으로 T를 돌려주는 코루틴. 만들기만 하면 시작하지 않고 누군가 co_await 할 때 시작한다.
+	                  끝나면 자기를 기다리던 코루틴을 바로 이어서 실행한다. (대칭 전환, 스택이 쌓이지 않는다)
+	2. Spawn        : Task를 ThreadPool에서 시작시키고 결과를 Future로 돌려준다. 코루틴이 아닌 곳(main)에서 쓴다.
+	3. Schedule     : co_await Schedule(pool)을 하면 그 뒤부터는 pool의 일꾼에서 실행된다.
+	4. AsyncMutex   : lock을 못 잡으면 스레드 대신 코루틴이 줄을 선다. Unlock이 다음 코루틴에게 lock을 넘겨준다.
+	5. AsyncEvent   : 06_Event의 Event를 코루틴용으로 바꾼 것. (Auto/Manual Reset)
+	6. PopAsync     : LockQueue에서 꺼낼 게 생길 때까지 기다린다. (LockQueue::PopWaiter)
+	7. Future<T>도 co_await 할 수 있다. Then 대신 값이 오면 코루틴을 이어서 실행한다.
+
+	기다리던 코루틴은 멈출 때 있던 ThreadPool(ThreadPool::GetCurrent)에서 깨어난다. 일꾼이 아니었으면 깨운 스레드에서 바로 이어서 실행된다.
+	코루틴 프레임은 promise_type의 operator new로 GMemory(Memory.h)의 크기별 풀에서 받는다.
+	예외는 다루지 않는다. (코루틴 안에서 예외가 빠져나오면 terminate)
+*/
+
+#include "Types.h"
+#include "Memory.h"
+#include "ThreadPool.h"
+#include "Future.h"
+#include "LockQueue.h"
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <utility>
+
+/////////////////////
+// CoroutineWaiter //
+/////////////////////
+//멈춘 코루틴과 다시 깨어날 곳
+struct CoroutineWaiter
+{
+	void Resume()
+	{
+		if (pool)
+			pool->Submit([handle = handle]() { handle.resume(); });
+		else
+			handle.resume();
+	}
+
+	std::coroutine_handle<> handle;
+	ThreadPool* pool = nullptr;
+};
+
+//코루틴 프레임을 GMemory에서 받는다. promise_type들이 상속해서 쓴다.
+struct PooledCoroutineFrame
+{
+	static void* operator new(size_t size) { return GMemory.Allocate(static_cast<__int32>(size)); }
+	static void operator delete(void* ptr) { GMemory.Release(ptr); }
+};
+
+template<typename T> class Task;
+
+/////////////////
+// TaskPromise //
+/////////////////
+template<typename T>
+class TaskPromiseBase : public PooledCoroutineFrame
+{
+	//끝나면 기다리던 코루틴으로 바로 넘어간다. 아무도 없으면 멈춘 채로 둔다. (Task가 프레임을 지운다)
+	struct FinalAwaiter
+	{
+		bool await_ready() noexcept { return false; }
+
+		template<typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			std::coroutine_handle<> continuation = handle.promise().continuation;
+			return continuation ? continuation : std::noop_coroutine();
+		}
+
+		void await_resume() noexcept {}
+	};
+
+public:
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	FinalAwaiter final_suspend() noexcept { return {}; }
+	void unhandled_exception() { std::terminate(); }
+
+	std::coroutine_handle<> continuation;
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase<T>
+{
+public:
+	Task<T> get_return_object();
+
+	template<typename U>
+	void return_value(U&& newValue) { value.emplace(std::forward<U>(newValue)); }
+
+	T TakeValue() { return std::move(*value); }
+
+private:
+	std::optional<T> value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase<void>
+{
+public:
+	Task<void> get_return_object();
+
+	void return_void() {}
+	void TakeValue() {}
+};
+
+//////////
+// Task //
+//////////
+template<typename T = void>
+class Task
+{
+public:
+	using promise_type = TaskPromise<T>;
+	using Handle = std::coroutine_handle<promise_type>;
+
+	explicit Task(Handle handle) : handle(handle) {}
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (handle)
+				handle.destroy();
+			handle = std::exchange(other.handle, nullptr);
+		}
+		return *this;
+	}
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	~Task()
+	{
+		if (handle)
+			handle.destroy();
+	}
+
+	//co_await 하면 그때 시작하고, 끝나면 co_return한 값이 나온다.
+	auto operator co_await() && noexcept
+	{
+		struct Awaiter
+		{
+			bool await_ready() noexcept { return false; }
+
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+			{
+				handle.promise().continuation = awaiting;
+				return handle;
+			}
+
+			T await_resume() { return handle.promise().TakeValue(); }
+
+			Handle handle;
+		};
+
+		return Awaiter{ handle };
+	}
+
+private:
+	Handle handle;
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() { return Task<T>(Task<T>::Handle::from_promise(*this)); }
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(Task<void>::Handle::from_promise(*this)); }
+
+//////////////
+// Schedule //
+//////////////
+//co_await Schedule(pool) 다음부터는 pool의 일꾼에서 실행된다.
+inline auto Schedule(ThreadPool& pool)
+{
+	struct Awaiter
+	{
+		bool await_ready() noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> handle) { pool.Submit([handle]() { handle.resume(); }); }
+		void await_resume() noexcept {}
+
+		ThreadPool& pool;
+	};
+
+	return Awaiter{ pool };
+}
+
+///////////
+// Spawn //
+///////////
+//Spawn 안에서만 쓰는 코루틴. 만들자마자 시작하고 끝나면 프레임을 스스로 지운다.
+struct DetachedCoroutine
+{
+	struct promise_type : PooledCoroutineFrame
+	{
+		DetachedCoroutine get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+template<typename T>
+DetachedCoroutine RunDetached(ThreadPool& pool, Task<T> task, Promise<typename ChainResult<T>::Type> promise)
+{
+	co_await Schedule(pool);
+
+	if constexpr (std::is_void_v<T>)
+	{
+		co_await std::move(task);
+		promise.SetValue(Unit{});
+	}
+	else
+	{
+		promise.SetValue(co_await std::move(task));
+	}
+}
+
+//task를 pool에서 시작한다. Task<void>면 Future<Unit>이 된다.
+template<typename T>
+Future<typename ChainResult<T>::Type> Spawn(ThreadPool& pool, Task<T> task)
+{
+	Promise<typename ChainResult<T>::Type> promise;
+	Future<typename ChainResult<T>::Type> future = promise.GetFuture();
+	RunDetached(pool, std::move(task), std::move(promise));
+	return future;
+}
+
+////////////////
+// AsyncMutex //
+////////////////
+/*
+	std::mutex로 막으면 lock을 기다리는 동안 스레드가 잠든다. 일꾼이 전부 잠들면 풀 전체가 멈춘다.
+	AsyncMutex는 lock을 못 잡은 코루틴을 줄 세워두고 스레드는 다른 일을 하러 보낸다.
+	Unlock은 lock을 풀지 않고 줄의 맨 앞 코루틴에게 그대로 넘겨준다. (중간에 다른 코루틴이 새치기하지 못한다)
+	내부의 std::mutex는 줄을 만지는 아주 짧은 동안만 잡는다.
+*/
+class AsyncMutex
+{
+	struct LockAwaiter
+	{
+		bool await_ready() noexcept { return false; }
+
+		//바로 잡았으면 false를 돌려줘서 멈추지 않고 계속 간다.
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			if (owner.locked == false)
+			{
+				owner.locked = true;
+				return false;
+			}
+
+			owner.waiters.push(CoroutineWaiter{ handle, ThreadPool::GetCurrent() });
+			return true;
+		}
+
+		void await_resume() noexcept {}
+
+		AsyncMutex& owner;
+	};
+
+public:
+	AsyncMutex() = default;
+	AsyncMutex(const AsyncMutex&) = delete;
+	AsyncMutex& operator=(const AsyncMutex&) = delete;
+
+	//co_await mutex.LockAsync(); 다음 줄부터 lock을 쥐고 있다.
+	LockAwaiter LockAsync() { return LockAwaiter{ *this }; }
+
+	bool TryLock()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (locked)
+			return false;
+
+		locked = true;
+		return true;
+	}
+
+	void Unlock()
+	{
+		CoroutineWaiter next;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (waiters.empty())
+			{
+				locked = false;
+				return;
+			}
+
+			next = waiters.front();
+			waiters.pop();
+		}
+
+		next.Resume();
+	}
+
+private:
+	std::mutex mutex;
+	bool locked = false;
+	std::queue<CoroutineWaiter> waiters;
+};
+
+//lock_guard처럼 범위를 벗어나면 Unlock (auto guard = co_await AsyncLockGuard::Lock(mutex);)
+class AsyncLockGuard
+{
+public:
+	static Task<AsyncLockGuard> Lock(AsyncMutex& mutex)
+	{
+		co_await mutex.LockAsync();
+		co_return AsyncLockGuard(mutex);
+	}
+
+	AsyncLockGuard(AsyncLockGuard&& other) noexcept : mutex(std::exchange(other.mutex, nullptr)) {}
+	AsyncLockGuard(const AsyncLockGuard&) = delete;
+	AsyncLockGuard& operator=(const AsyncLockGuard&) = delete;
+
+	~AsyncLockGuard()
+	{
+		if (mutex)
+			mutex->Unlock();
+	}
+
+private:
+	explicit AsyncLockGuard(AsyncMutex& mutex) : mutex(&mutex) {}
+
+	AsyncMutex* mutex = nullptr;
+};
+
+////////////////
+// AsyncEvent //
+////////////////
+/*
+	06_Event의 CreateEvent(NULL, manualReset, initialState, NULL)와 같은 모양이다.
+	1. Auto Reset   : Set 한번에 기다리던 코루틴 하나만 깨우고 바로 다시 꺼진다. 기다리는 코루틴이 없으면 켜진 채로 다음 Wait을 통과시킨다.
+	2. Manual Reset : Set하면 기다리던 코루틴을 전부 깨우고 Reset할 때까지 켜져 있다.
+	WaitForSingleObject와 달리 기다리는 동안 스레드가 잠들지 않는다.
+*/
+class AsyncEvent
+{
+	struct WaitAwaiter
+	{
+		bool await_ready() noexcept { return false; }
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			if (owner.signaled)
+			{
+				if (owner.manualReset == false)
+					owner.signaled = false;
+				return false;
+			}
+
+			owner.waiters.push(CoroutineWaiter{ handle, ThreadPool::GetCurrent() });
+			return true;
+		}
+
+		void await_resume() noexcept {}
+
+		AsyncEvent& owner;
+	};
+
+public:
+	AsyncEvent(bool manualReset, bool initialState) : manualReset(manualReset), signaled(initialState) {}
+	AsyncEvent(const AsyncEvent&) = delete;
+	AsyncEvent& operator=(const AsyncEvent&) = delete;
+
+	//co_await event.Wait();
+	WaitAwaiter Wait() { return WaitAwaiter{ *this }; }
+
+	void Set()
+	{
+		std::queue<CoroutineWaiter> woken;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (manualReset)
+			{
+				signaled = true;
+				woken.swap(waiters);
+			}
+			else if (waiters.empty())
+			{
+				signaled = true;
+			}
+			else
+			{
+				woken.push(waiters.front());
+				waiters.pop();
+			}
+		}
+
+		//깨우는 건 lock 밖에서 한다. (LockQueue의 notify와 같은 이유)
+		for (; woken.empty() == false; woken.pop())
+			woken.front().Resume();
+	}
+
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		signaled = false;
+	}
+
+private:
+	std::mutex mutex;
+	const bool manualReset;
+	bool signaled;
+	std::queue<CoroutineWaiter> waiters;
+};
+
+////////////////////////
+// co_await Future<T> //
+////////////////////////
+//T value = co_await std::move(future);
+template<typename T>
+auto operator co_await(Future<T>&& future)
+{
+	struct Awaiter
+	{
+		bool await_ready() noexcept { return false; }
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			//값이 이미 와 있으면 OnComplete 안에서 바로 깨어난다. 그 뒤로는 이 Awaiter를 건드리지 않는다.
+			future.OnComplete([this, waiter = CoroutineWaiter{ handle, ThreadPool::GetCurrent() }](std::optional<T>&& newValue, const std::exception_ptr& newError) mutable
+			{
+				value = std::move(newValue);
+				error = newError;
+				waiter.Resume();
+			});
+		}
+
+		//Future가 실패했으면 코루틴 안에서 그 예외를 던진다. (잡지 않으면 terminate)
+		T await_resume()
+		{
+			if (error)
+				std::rethrow_exception(error);
+			return std::move(*value);
+		}
+
+		Future<T> future;
+		std::optional<T> value;
+		std::exception_ptr error;
+	};
+
+	return Awaiter{ std::move(future), std::nullopt, nullptr };
+}
+
+//////////////
+// PopAsync //
+//////////////
+//co_await PopAsync(queue, value); 꺼낼 게 생길 때까지 코루틴만 멈춘다.
+template<typename T>
+auto PopAsync(LockQueue<T>& queue, T& value)
+{
+	struct Awaiter : LockQueue<T>::PopWaiter
+	{
+		Awaiter(LockQueue<T>& queue, T& value) : queue(queue)
+		{
+			this->value = &value;
+			this->Wake = &Awaiter::OnWake;
+		}
+
+		bool await_ready() noexcept { return false; }
+
+		bool await_suspend(std::coroutine_handle<> handle)
+		{
+			//TryPopOrWait가 대기표를 거는 순간 다른 스레드의 Push가 Wake를 부를 수 있으니 먼저 채워둔다.
+			waiter = CoroutineWaiter{ handle, ThreadPool::GetCurrent() };
+			return queue.TryPopOrWait(this) == false;
+		}
+
+		void await_resume() noexcept {}
+
+		static void OnWake(typename LockQueue<T>::PopWaiter* popWaiter)
+		{
+			static_cast<Awaiter*>(popWaiter)->waiter.Resume();
+		}
+
+		LockQueue<T>& queue;
+		CoroutineWaiter waiter;
+	};
+
+	return Awaiter(queue, value);
+}
@@ -0,0 +1,158 @@
+﻿#pragma once
+
+/*
+	15_LockFree_Stack_2의 스택은 Push 할 때마다 new Node와 make_shared<T>로 할당을 두번 하고
+	TryPop은 shared_ptr<T>를 돌려주기 때문에 꺼낼 때마다 참조 카운트도 atomic으로 건드린다.
+	LockFreeStack<T, SplitRefCount>(LockFreeStack.h)는 T를 노드 안에 넣었지만 여전히 노드마다 new를 한다.
+
+	CountedStack은 같은 외부/내부 참조 카운트 방식에서 할당을 전부 없앤 버전이다.
+	1. T는 노드 안에 바로 만든다. (Push는 move/forward로 만들고 TryPop은 move로 꺼낸다)
+	2. 노드는 스택마다 하나씩 가진 MemoryPool에서 꺼내고 참조 카운트가 0이 되면 바로 돌려준다.
+	   참조 카운트를 가진 스레드만 노드를 만지기 때문에 Hazard Pointer나 EBR처럼 회수를 미룰 필요가 없다.
+	   (카운트 없이 들고 있는 oldHead는 CAS의 비교값으로만 쓰고 따라가지 않는다)
+	3. 풀이 충분히 커진 뒤에는(steady state) Push/TryPop 어디에서도 할당을 하지 않는다. (36_CountedStack)
+
+	꺼낸 값은 TryPop한 스레드가 move 해가기 때문에 TryPeek은 없다.
+	다른 스레드가 읽고 있는 도중에 move 해버릴 수 있어서다. (LockFreeStack의 TryPop이 move 대신 복사를 하는 이유)
+*/
+
+#include "AtomicPair.h"
+#include "MemoryPool.h"
+#include <atomic>
+#include <new>
+#include <optional>
+#include <utility>
+
+//////////////////
+// CountedStack //
+//////////////////
+template<typename T>
+class CountedStack
+{
+	struct Node;
+
+	//tag가 외부 참조 카운트(externalCount)다.
+	using CountedNodePtr = TaggedPtr<Node>;
+
+	//풀의 블록 위에 바로 만든다.
+	struct Node
+	{
+		T* Data() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+		CountedNodePtr next;
+		std::atomic<__int32> internalCount = 0;
+
+		//값은 Push에서 만들고 TryPop에서 꺼내면서 소멸시킨다.
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	static_assert(alignof(T) <= SLIST_ALIGNMENT, "CountedStack은 16바이트보다 크게 정렬된 타입은 지원하지 않는다.");
+	static_assert(AtomicTaggedPtr<Node>::TAG_BITS >= 32, "CountedStack은 16바이트 CAS(DWCAS)가 되는 플랫폼에서만 쓸 수 있다.");
+
+public:
+	CountedStack() : nodePool(sizeof(Node)) {}
+	CountedStack(const CountedStack&) = delete;
+	CountedStack& operator=(const CountedStack&) = delete;
+
+	//다른 스레드가 쓰고 있지 않다고 가정한다. 블록은 nodePool이 사라지면서 한번에 돌려준다.
+	~CountedStack()
+	{
+		Node* node = head.LoadRelaxed().ptr;
+		while (node)
+		{
+			Node* next = node->next.ptr;
+			node->Data()->~T();
+			node->~Node();
+			node = next;
+		}
+	}
+
+	template<typename U>
+	void Push(U&& value)
+	{
+		Node* node = new(nodePool.Pop())Node();
+		new(node->Data())T(std::forward<U>(value));
+
+		CountedNodePtr newHead;
+		newHead.ptr = node;
+		newHead.tag = 1;
+		node->next = head.LoadRelaxed();
+		while (head.CompareExchange(node->next, newHead) == false)
+		{
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		return TryPopWith([&value](T& data) { value = std::move(data); });
+	}
+
+	//T가 기본 생성자가 없거나 만들기 비쌀 때
+	std::optional<T> TryPop()
+	{
+		std::optional<T> value;
+		TryPopWith([&value](T& data) { value.emplace(std::move(data)); });
+		return value;
+	}
+
+	//노드 풀이 OS에서 받아온 Slab 수. steady state에서는 늘어나지 않아야 한다.
+	__int32 GetSlabCount() const { return nodePool.GetSlabCount(); }
+
+private:
+	//head를 떼어내는데 성공하면 take로 값을 넘겨서 move 해가게 한다.
+	template<typename Take>
+	bool TryPopWith(Take&& take)
+	{
+		CountedNodePtr oldHead = head.LoadRelaxed();
+		while (true)
+		{
+			IncreaseHeadCount(oldHead);
+
+			Node* ptr = oldHead.ptr;
+			if (ptr == nullptr)
+				return false;
+
+			if (head.CompareExchange(oldHead, ptr->next))
+			{
+				//값은 나만 만진다. 아직 카운트를 들고 있는 스레드들은 next와 internalCount만 본다.
+				take(*ptr->Data());
+				ptr->Data()->~T();
+
+				const __int32 countIncrease = static_cast<__int32>(oldHead.tag - 2);
+				if (ptr->internalCount.fetch_add(countIncrease) == -countIncrease)
+					ReleaseNode(ptr);
+
+				return true;
+			}
+			else if (ptr->internalCount.fetch_sub(1) == 1)
+			{
+				ReleaseNode(ptr);
+			}
+		}
+	}
+
+	//값은 이미 꺼내갔기 때문에 노드만 정리해서 풀에 돌려준다.
+	void ReleaseNode(Node* node)
+	{
+		node->~Node();
+		nodePool.Push(reinterpret_cast<MemoryHeader*>(node));
+	}
+
+	void IncreaseHeadCount(CountedNodePtr& oldCounter)
+	{
+		while (true)
+		{
+			CountedNodePtr newCounter = oldCounter;
+			newCounter.tag++;
+			if (head.CompareExchange(oldCounter, newCounter))
+			{
+				oldCounter.tag = newCounter.tag;
+				break;
+			}
+		}
+	}
+
+private:
+	AtomicTaggedPtr<Node> head;
+	MemoryPool nodePool;
+};
@@ -0,0 +1,145 @@
+﻿#pragma once
+
+/*
+	스레드가 많아지면 LockFreeStack의 Push/TryPop은 전부 head 하나를 두고 CAS를 한다.
+	한 명이 성공하면 나머지는 전부 실패하고 다시 시도하기 때문에 결국 한 줄로 서서 차례를 기다리는 것과 같아진다.
+
+	그런데 Push 하나와 TryPop 하나가 동시에 들어왔다면 굳이 head를 거칠 필요가 없다.
+	Push한 값을 TryPop이 바로 받아가면 스택 입장에서는 넣었다가 바로 뺀 것과 똑같기 때문이다. (Elimination, 서로 상쇄)
+	1. CAS를 FAIL_THRESHOLD번 실패하면 (경합이 심하다는 뜻) Elimination 배열의 칸 하나를 고른다.
+	2. Push는 그 칸에 노드를 올려놓고 잠깐 기다린다. TryPop이 가져가면 끝, 아무도 안 가져가면 도로 회수해서 다시 head로 간다.
+	3. TryPop은 그 칸에 노드가 있으면 CAS로 가져간다.
+	4. 칸을 고르는 범위(range)는 스레드마다 따로 조절한다. 상대를 못 만나면 좁히고, 다른 스레드와 부딪히면 넓힌다.
+
+	LockFreeStack<T, Reclaim, Backoff>의 Backoff로 끼워서 쓴다. NoElimination을 넣으면 아무것도 하지 않는다.
+*/
+
+#include "Types.h"
+#include "Random.h"
+#include <atomic>
+
+///////////////////
+// NoElimination //
+///////////////////
+//Elimination을 쓰지 않는다. 모든 함수가 바로 실패하기 때문에 컴파일러가 전부 지워준다.
+struct NoElimination
+{
+	enum { FAIL_THRESHOLD = 0x7FFFFFFF };
+
+	bool TryGive(void*) { return false; }
+	void* TryTake() { return nullptr; }
+	__int64 GetEliminatedCount() const { return 0; }
+};
+
+//////////////////////
+// EliminationArray //
+//////////////////////
+class EliminationArray
+{
+public:
+	enum
+	{
+		SLOT_COUNT = 16,		//칸 수. 스레드가 많아도 이 이상은 서로 만나기 힘들어진다.
+		FAIL_THRESHOLD = 2,		//head CAS를 이만큼 실패하면 Elimination을 시도한다.
+		SPIN_COUNT = 128		//Push가 칸에 노드를 올려두고 기다리는 횟수
+	};
+
+	//Push 쪽. 노드를 TryPop에게 넘겨줬으면 true
+	bool TryGive(void* node)
+	{
+		Slot& slot = slots[PickSlot()];
+
+		void* expected = nullptr;
+		if (slot.offer.compare_exchange_strong(expected, node, std::memory_order_release, std::memory_order_relaxed) == false)
+		{
+			//다른 스레드가 쓰고 있다. 다음에는 더 넓게 고른다.
+			Widen();
+			return false;
+		}
+
+		for (__int32 i = 0; i < SPIN_COUNT; i++)
+		{
+			if (slot.offer.load(std::memory_order_acquire) == TAKEN)
+				break;
+		}
+
+		//아무도 안 가져갔으면 회수한다. 회수에 실패했다면 그 사이에 가져간 것이다.
+		expected = node;
+		if (slot.offer.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed))
+		{
+			Narrow();
+			return false;
+		}
+
+		//TAKEN을 비워주는 건 노드를 올려놓은 쪽만 한다. (그래야 다른 Push가 내 칸을 덮어쓰지 않는다)
+		slot.offer.store(nullptr, std::memory_order_release);
+		Widen();
+		return true;
+	}
+
+	//TryPop 쪽. Push가 올려둔 노드가 있으면 가져온다.
+	void* TryTake()
+	{
+		Slot& slot = slots[PickSlot()];
+
+		void* node = slot.offer.load(std::memory_order_acquire);
+		if (node == nullptr || node == TAKEN)
+		{
+			Narrow();
+			return nullptr;
+		}
+
+		if (slot.offer.compare_exchange_strong(node, TAKEN, std::memory_order_acquire, std::memory_order_relaxed) == false)
+		{
+			Widen();
+			return nullptr;
+		}
+
+		//방금 CAS한 칸과 같은 캐시라인이라 따로 세도 부담이 적다.
+		slot.eliminatedCount.fetch_add(1, std::memory_order_relaxed);
+		return node;
+	}
+
+	__int64 GetEliminatedCount() const
+	{
+		__int64 count = 0;
+		for (const Slot& slot : slots)
+			count += slot.eliminatedCount.load(std::memory_order_relaxed);
+		return count;
+	}
+
+private:
+	//Push가 올려둔 노드를 TryPop이 가져갔다는 표시. 노드 주소는 8바이트 단위 이상이라 1과 겹치지 않는다.
+	static inline void* const TAKEN = reinterpret_cast<void*>(1);
+
+	//칸마다 다른 스레드들이 CAS를 하기 때문에 캐시라인을 따로 쓴다.
+	struct alignas(CACHE_LINE_SIZE) Slot
+	{
+		std::atomic<void*> offer = nullptr;
+		std::atomic<__int64> eliminatedCount = 0;
+	};
+
+	//스레드마다 [0, range) 안에서 칸을 고른다.
+	static __int32 PickSlot()
+	{
+		return static_cast<__int32>(ThreadRandom() % LRange);
+	}
+
+	static void Widen()
+	{
+		if (LRange < SLOT_COUNT)
+			LRange++;
+	}
+
+	static void Narrow()
+	{
+		if (LRange > 1)
+			LRange--;
+	}
+
+private:
+	Slot slots[SLOT_COUNT];
+
+	//스택마다가 아니라 스레드마다 하나씩이다. (경합 정도는 스레드 수에 더 크게 좌우된다)
+	static inline thread_local __int32 LRange = 1;
+};
@@ -0,0 +1,264 @@
+﻿#pragma once
+
+/*
+	HazardPointer.h의 Hazard Pointer는 노드 하나를 읽을 때마다 그 주소를 적고(seq_cst store) 다시 확인해야 한다.
+	15_LockFree_Stack_2의 참조 카운트 방식은 head 하나 읽는 데 128비트 CAS가 필요하다.
+	읽기가 대부분인 자료구조에서는 이 비용이 읽을 때마다 붙는다.
+
+	Epoch Based Reclamation(EBR)은 노드 단위가 아니라 "구간" 단위로 보호한다.
+	1. 전역 epoch 번호가 하나 있고, 스레드는 자료구조를 만지기 전에 지금 epoch 번호를 자기 칸에 적는다. (Pin)
+	   다 쓰고 나면 지운다. (Unpin) 그 사이에 읽는 노드는 아무것도 적지 않고 그냥 읽는다.
+	2. 떼어낸 노드는 떼어낸 때의 epoch 번호를 붙여서 limbo 목록에 넣어둔다.
+	3. Pin 중인 스레드가 전부 지금 epoch까지 따라왔으면 전역 epoch를 하나 올린다.
+	4. 전역 epoch가 e + 2가 되면 e에 떼어낸 노드를 보고 있는 스레드는 더 이상 없으니 지운다.
+	   그래서 limbo 목록은 epoch % 3 으로 3개만 있으면 된다.
+
+	대신 Pin 한 채로 오래 멈춰있는 스레드가 하나라도 있으면 epoch가 올라가지 못해서 아무것도 지우지 못한다.
+	(Hazard Pointer는 그 스레드가 보고 있는 노드만 남는다) Pin 구간은 짧게 써야 한다.
+
+	구조는 HazardPointer.h와 같다. 전역에 GEpochDomain, 스레드마다 LEpochThread를 두고
+	자료구조 쪽에서는 EpochGuard로 구간을 잡고 EpochRetire로 넘긴다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <vector>
+
+/////////////////
+// EpochDomain //
+/////////////////
+class EpochDomain
+{
+public:
+	enum
+	{
+		LIMBO_COUNT = 3,			//e, e - 1, e - 2
+		ADVANCE_INTERVAL = 64		//Retire를 이만큼 할 때마다 epoch를 올려본다.
+	};
+
+	struct Retired
+	{
+		void* ptr;
+		void (*deleter)(void*);
+	};
+
+	struct Limbo
+	{
+		unsigned __int64 epoch = 0;
+		std::vector<Retired> retired;
+	};
+
+	//스레드 하나가 쓰는 칸과 limbo 목록. 스레드가 끝나면 다음 스레드가 물려받아 쓴다.
+	struct alignas(CACHE_LINE_SIZE) Record
+	{
+		//Pin 중이면 (epoch << 1) | 1, 아니면 0
+		std::atomic<unsigned __int64> state = 0;
+		std::atomic<bool> active = false;
+		Record* next = nullptr;
+
+		//이 Record를 가진 스레드만 만진다.
+		Limbo limbos[LIMBO_COUNT];
+		__int64 retireCount = 0;
+	};
+
+	EpochDomain() = default;
+	EpochDomain(const EpochDomain&) = delete;
+	EpochDomain& operator=(const EpochDomain&) = delete;
+
+	~EpochDomain()
+	{
+		Record* record = records.load(std::memory_order_acquire);
+		while (record)
+		{
+			Record* next = record->next;
+			for (Limbo& limbo : record->limbos)
+				FreeLimbo(limbo);
+			delete record;
+			record = next;
+		}
+	}
+
+	//HazardDomain::AcquireRecord와 같다.
+	Record* AcquireRecord()
+	{
+		for (Record* record = records.load(std::memory_order_acquire); record; record = record->next)
+		{
+			bool expected = false;
+			if (record->active.load(std::memory_order_relaxed) == false && record->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				return record;
+		}
+
+		Record* record = new Record();
+		record->active.store(true, std::memory_order_relaxed);
+		record->next = records.load(std::memory_order_relaxed);
+		while (records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed) == false)
+		{
+		}
+		return record;
+	}
+
+	void ReleaseRecord(Record* record)
+	{
+		record->state.store(0, std::memory_order_release);
+		Collect(record);
+		record->active.store(false, std::memory_order_release);
+	}
+
+	/*
+		적고 나서 전역 epoch가 그대로인지 다시 확인한다.
+		적기 전에 epoch가 올라갔다면 나는 옛날 epoch에 Pin 한 채로 새 노드를 읽게 되고
+		그 사이 epoch가 두번 더 올라가면 읽고 있는 노드가 지워질 수 있기 때문이다.
+	*/
+	void Pin(Record* record)
+	{
+		unsigned __int64 epoch = globalEpoch.load(std::memory_order_relaxed);
+		while (true)
+		{
+			record->state.store((epoch << 1) | 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			const unsigned __int64 current = globalEpoch.load(std::memory_order_relaxed);
+			if (current == epoch)
+				return;
+			epoch = current;
+		}
+	}
+
+	void Unpin(Record* record)
+	{
+		//Pin 구간 안에서 읽은 것들이 Unpin보다 먼저 끝나야 한다.
+		record->state.store(0, std::memory_order_release);
+	}
+
+	void Retire(Record* record, void* ptr, void (*deleter)(void*))
+	{
+		const unsigned __int64 epoch = globalEpoch.load(std::memory_order_acquire);
+
+		//같은 칸에 있던건 epoch - 3 이전에 떼어낸 것이니 이미 지워도 된다.
+		Limbo& limbo = record->limbos[epoch % LIMBO_COUNT];
+		if (limbo.epoch != epoch)
+		{
+			FreeLimbo(limbo);
+			limbo.epoch = epoch;
+		}
+		limbo.retired.push_back(Retired{ ptr, deleter });
+
+		if (++record->retireCount % ADVANCE_INTERVAL == 0)
+		{
+			TryAdvance();
+			Collect(record);
+		}
+	}
+
+	//Pin 중인 스레드가 전부 지금 epoch에 와 있으면 하나 올린다.
+	bool TryAdvance()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		unsigned __int64 epoch = globalEpoch.load(std::memory_order_relaxed);
+		for (Record* record = records.load(std::memory_order_acquire); record; record = record->next)
+		{
+			const unsigned __int64 state = record->state.load(std::memory_order_relaxed);
+			if ((state & 1) != 0 && (state >> 1) != epoch)
+				return false;
+		}
+
+		return globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+	}
+
+	//전역 epoch보다 2 이상 뒤처진 limbo를 지운다.
+	void Collect(Record* record)
+	{
+		const unsigned __int64 epoch = globalEpoch.load(std::memory_order_acquire);
+		for (Limbo& limbo : record->limbos)
+		{
+			if (limbo.epoch + 2 <= epoch)
+				FreeLimbo(limbo);
+		}
+	}
+
+	unsigned __int64 GetEpoch() const { return globalEpoch.load(std::memory_order_relaxed); }
+
+private:
+	static void FreeLimbo(Limbo& limbo)
+	{
+		for (Retired& retired : limbo.retired)
+			retired.deleter(retired.ptr);
+		limbo.retired.clear();
+	}
+
+private:
+	//Pin 할 때마다 모든 스레드가 읽는 값이라 Record 목록과 캐시라인을 나눈다.
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned __int64> globalEpoch = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<Record*> records = nullptr;
+};
+
+//프로그램 전체에서 하나만 쓰는 EpochDomain (G는 Global)
+inline EpochDomain GEpochDomain;
+
+/////////////////
+// EpochThread //
+/////////////////
+class EpochThread
+{
+public:
+	~EpochThread()
+	{
+		if (record != nullptr)
+			GEpochDomain.ReleaseRecord(record);
+	}
+
+	EpochDomain::Record* GetRecord()
+	{
+		if (record == nullptr)
+			record = GEpochDomain.AcquireRecord();
+		return record;
+	}
+
+	//EpochGuard가 겹쳐도 제일 바깥쪽에서만 Pin/Unpin 한다.
+	void Enter()
+	{
+		if (pinCount++ == 0)
+			GEpochDomain.Pin(GetRecord());
+	}
+
+	void Leave()
+	{
+		if (--pinCount == 0)
+			GEpochDomain.Unpin(record);
+	}
+
+private:
+	EpochDomain::Record* record = nullptr;
+	__int32 pinCount = 0;
+};
+
+//스레드마다 하나씩 갖는 epoch 정보 (L은 Local)
+inline thread_local EpochThread LEpochThread;
+
+////////////////
+// EpochGuard //
+////////////////
+//살아있는 동안 Pin 되어 있다. 이 안에서 읽은 노드는 EpochGuard가 사라질 때까지 지워지지 않는다.
+class EpochGuard
+{
+public:
+	EpochGuard() { LEpochThread.Enter(); }
+	~EpochGuard() { LEpochThread.Leave(); }
+
+	EpochGuard(const EpochGuard&) = delete;
+	EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+//자료구조에서 떼어낸 포인터를 넘긴다. 전역 epoch가 두번 올라가면 delete 된다.
+template<typename T>
+void EpochRetire(T* ptr)
+{
+	GEpochDomain.Retire(LEpochThread.GetRecord(), ptr, [](void* p) { delete static_cast<T*>(p); });
+}
+
+//delete 대신 deleter를 부른다.
+inline void EpochRetire(void* ptr, void (*deleter)(void*))
+{
+	GEpochDomain.Retire(LEpochThread.GetRecord(), ptr, deleter);
+}
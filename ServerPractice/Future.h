@@ -0,0 +1,508 @@
+﻿#pragma once
+
+/*
+	08_Future의 std::future는 결과를 받으려면 get()으로 기다리는 수밖에 없다.
+	요청 하나가 DB 조회 -> 가공 -> 응답처럼 여러 단계를 거친다면 단계마다 스레드 하나가 get()에 막혀서 잠들어 있게 되고
+	동시에 처리 중인 요청이 수천개면 잠든 스레드도 수천개가 된다.
+
+	Future<T>는 기다리는 대신 "값이 오면 이걸 해줘"를 붙여두는(Then) 방식이다.
+	1. Promise<T>::SetValue와 Future<T>::Then 중 나중에 온 쪽이 이어서 할 일(continuation)을 ThreadPool에 넘긴다.
+	   누가 먼저 왔는지는 공유 상태(State)의 state 하나를 CAS 해서 정한다. (lock이 없다)
+	2. Then이 돌려주는 Future로 또 Then을 붙일 수 있다. 넘긴 함수가 Future를 돌려주면 그 Future가 끝날 때 이어진다.
+	3. WhenAll은 전부 끝나면, WhenAny는 하나라도 끝나면 준비되는 Future를 만든다.
+	4. 기다리는 스레드가 없으니 동시에 처리 중인 요청이 아무리 많아도 스레드는 ThreadPool의 일꾼 수만큼만 있으면 된다.
+
+	Promise와 Future가 같이 보는 State는 ObjectPool에서 꺼낸다. 요청마다 몇개씩 생겼다 사라지기 때문.
+	실패는 값 대신 std::exception_ptr로 채워진다. (Promise::SetException, Then에 넘긴 함수가 던진 예외, 값을 넣지 않고 사라진 Promise)
+	실패한 Future에 붙인 Then은 함수를 부르지 않고 실패를 그대로 다음 Future로 넘기고, Get은 그 예외를 다시 던진다.
+	Future는 한번만 쓸 수 있다. Then, Get을 부르면 비어있는 Future가 된다. (std::future::get과 같다)
+*/
+
+#include "Types.h"
+#include "ObjectPool.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//값이 없는 Future<void> 대신 쓴다. Then에 넘긴 함수가 아무것도 돌려주지 않으면 Future<Unit>이 된다.
+struct Unit {};
+
+template<typename T> class Future;
+template<typename T> class Promise;
+
+/////////////////
+// FutureState //
+/////////////////
+template<typename T>
+class FutureState
+{
+public:
+	enum
+	{
+		EMPTY,			//아직 아무 일도 없다.
+		WAITING,		//Get으로 기다리는 스레드가 있다.
+		CONTINUATION,	//Then이 먼저 와서 할 일을 붙여두고 갔다.
+		READY			//값이나 에러가 들어왔다.
+	};
+
+	template<typename U>
+	void SetValue(U&& newValue)
+	{
+		value.emplace(std::forward<U>(newValue));
+		Complete();
+	}
+
+	void SetException(std::exception_ptr newError)
+	{
+		error = std::move(newError);
+		Complete();
+	}
+
+	//continuation이 받은 결과를 그대로 옮겨 담는다. (Then이 다음 State로 넘길 때 쓴다)
+	void SetResult(std::optional<T>&& newValue, const std::exception_ptr& newError)
+	{
+		if (newError)
+			SetException(newError);
+		else
+			SetValue(std::move(*newValue));
+	}
+
+	/*
+		끝나면 func(std::optional<T>&& value, const std::exception_ptr& error)를 부른다. 실패했으면 value가 비어있다.
+		executor가 있으면 거기서, 없으면 값을 넣은 스레드에서 바로 부른다.
+	*/
+	template<typename Func>
+	void SetContinuation(ThreadPool* newExecutor, Func&& func)
+	{
+		executor = newExecutor;
+		continuation = [this, func = std::forward<Func>(func)]() mutable
+		{
+			func(std::move(value), error);
+			Release();
+		};
+
+		__int32 expected = EMPTY;
+		if (state.compare_exchange_strong(expected, CONTINUATION, std::memory_order_acq_rel))
+			return;
+
+		//값이 먼저 와 있었다.
+		Fire();
+	}
+
+	//값이나 에러가 올 때까지 재운다.
+	void Wait()
+	{
+		__int32 expected = EMPTY;
+		if (state.compare_exchange_strong(expected, WAITING, std::memory_order_acquire))
+			expected = WAITING;
+
+		while (expected == WAITING)
+		{
+			state.wait(WAITING, std::memory_order_acquire);
+			expected = state.load(std::memory_order_acquire);
+		}
+	}
+
+	//Wait 다음에 부른다.
+	const std::exception_ptr& GetError() const { return error; }
+	T TakeValue() { return std::move(*value); }
+
+	bool IsReady() const { return state.load(std::memory_order_acquire) == READY; }
+
+	void AddRef() { refCount.fetch_add(1, std::memory_order_relaxed); }
+
+	void Release()
+	{
+		if (refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			ObjectPool<FutureState>::Push(this);
+	}
+
+private:
+	//value나 error를 채운 다음 부른다.
+	void Complete()
+	{
+		__int32 expected = EMPTY;
+		if (state.compare_exchange_strong(expected, READY, std::memory_order_acq_rel))
+			return;
+
+		if (expected == WAITING)
+		{
+			state.store(READY, std::memory_order_release);
+			state.notify_all();
+			return;
+		}
+
+		//Then이 먼저 왔다. acq_rel CAS가 실패하면서 continuation을 쓴 것도 보인다.
+		Fire();
+	}
+
+	void Fire()
+	{
+		//continuation이 끝나면서 Release로 State를 지울 수 있으니 꺼내놓고 부른다.
+		std::function<void()> func = std::move(continuation);
+		if (executor)
+			executor->Submit(std::move(func));
+		else
+			func();
+	}
+
+private:
+	//Promise와 Future가 하나씩 가지고 시작한다.
+	std::atomic<__int32> refCount = 2;
+	std::atomic<__int32> state = EMPTY;
+	std::optional<T> value;
+	std::exception_ptr error;
+	ThreadPool* executor = nullptr;
+	std::function<void()> continuation;
+};
+
+/////////////
+// Promise //
+/////////////
+template<typename T>
+class Promise
+{
+public:
+	Promise() : state(ObjectPool<FutureState<T>>::Pop()) {}
+	Promise(Promise&& other) noexcept : state(std::exchange(other.state, nullptr)), retrieved(other.retrieved) {}
+	Promise(const Promise&) = delete;
+	Promise& operator=(const Promise&) = delete;
+
+	//값을 넣지 않고 사라지면 Future가 영영 준비되지 않으니 broken_promise 에러로 끝낸다.
+	~Promise()
+	{
+		if (state == nullptr)
+			return;
+		SetException(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+	}
+
+	//한번만 부를 수 있다.
+	Future<T> GetFuture()
+	{
+		retrieved = true;
+		return Future<T>(state);
+	}
+
+	template<typename U>
+	void SetValue(U&& value)
+	{
+		FutureState<T>* s = std::exchange(state, nullptr);
+		if (retrieved == false)
+			s->Release();
+		s->SetValue(std::forward<U>(value));
+		s->Release();
+	}
+
+	void SetException(std::exception_ptr error)
+	{
+		FutureState<T>* s = std::exchange(state, nullptr);
+		if (retrieved == false)
+			s->Release();
+		s->SetException(std::move(error));
+		s->Release();
+	}
+
+private:
+	FutureState<T>* state = nullptr;
+	bool retrieved = false;
+};
+
+////////////
+// Future //
+////////////
+//Then에 넘긴 함수가 R을 돌려줄 때 Then이 돌려주는 Future<?>의 ?
+template<typename R> struct ChainResult { using Type = R; };
+template<> struct ChainResult<void> { using Type = Unit; };
+template<typename R> struct ChainResult<Future<R>> { using Type = R; };
+
+template<typename R> struct IsFuture : std::false_type {};
+template<typename R> struct IsFuture<Future<R>> : std::true_type {};
+
+template<typename T>
+class Future
+{
+	template<typename U> friend class Future;
+	friend class Promise<T>;
+
+	explicit Future(FutureState<T>* state) : state(state) {}
+
+public:
+	using ValueType = T;
+
+	Future() = default;
+	Future(Future&& other) noexcept : state(std::exchange(other.state, nullptr)) {}
+	Future& operator=(Future&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (state)
+				state->Release();
+			state = std::exchange(other.state, nullptr);
+		}
+		return *this;
+	}
+	Future(const Future&) = delete;
+	Future& operator=(const Future&) = delete;
+
+	~Future()
+	{
+		if (state)
+			state->Release();
+	}
+
+	bool IsValid() const { return state != nullptr; }
+	bool IsReady() const { return state && state->IsReady(); }
+
+	/*
+		값이 올 때까지 이 스레드를 재운다. 일꾼 스레드에서 부르면 일꾼 하나가 통째로 멈추니 main에서 마지막 결과를 받을 때만 쓴다.
+		실패했으면 그 예외를 던진다.
+	*/
+	T Get()
+	{
+		FutureState<T>* s = std::exchange(state, nullptr);
+		s->Wait();
+
+		if (std::exception_ptr error = s->GetError())
+		{
+			s->Release();
+			std::rethrow_exception(error);
+		}
+
+		T value = s->TakeValue();
+		s->Release();
+		return value;
+	}
+
+	/*
+		값이 오면 pool에서 func(T)를 부른다.
+		func가 R을 돌려주면 Future<R>, 아무것도 안 돌려주면 Future<Unit>, Future<R>을 돌려주면 그게 끝날 때 준비되는 Future<R>이 된다.
+	*/
+	template<typename Func>
+	auto Then(ThreadPool& pool, Func&& func)
+	{
+		return Chain(&pool, std::forward<Func>(func));
+	}
+
+	//값을 넣은 스레드에서 바로 부른다. 아주 짧은 일에만 쓴다.
+	template<typename Func>
+	auto ThenInline(Func&& func)
+	{
+		return Chain(nullptr, std::forward<Func>(func));
+	}
+
+	/*
+		값이든 에러든 끝나면 값을 넣은 스레드에서 바로 func(std::optional<T>&& value, const std::exception_ptr& error)를 부른다.
+		실패했으면 value가 비어있다. WhenAll처럼 실패도 직접 받아서 처리해야 할 때 쓴다.
+	*/
+	template<typename Func>
+	void OnComplete(Func&& func)
+	{
+		FutureState<T>* s = std::exchange(state, nullptr);
+		s->SetContinuation(nullptr, std::forward<Func>(func));
+	}
+
+private:
+	template<typename Func>
+	auto Chain(ThreadPool* executor, Func&& func)
+	{
+		using R = std::invoke_result_t<Func, T&&>;
+		using Result = typename ChainResult<R>::Type;
+
+		//다음 Future의 State는 Promise 없이 직접 다룬다. (continuation이 복사 가능해야 해서 Promise를 캡처할 수 없다)
+		FutureState<Result>* next = ObjectPool<FutureState<Result>>::Pop();
+		Future<Result> result(next);
+
+		FutureState<T>* s = std::exchange(state, nullptr);
+		s->SetContinuation(executor, [next, func = std::forward<Func>(func)](std::optional<T>&& value, const std::exception_ptr& error) mutable
+		{
+			//앞에서 실패했으면 func는 부르지 않고 실패만 넘긴다.
+			if (error)
+			{
+				next->SetException(error);
+				next->Release();
+				return;
+			}
+
+			//func가 던진 예외는 다음 Future의 실패가 된다. next를 채우는 건 try 밖에서 해야 두번 채우지 않는다.
+			if constexpr (IsFuture<R>::value)
+			{
+				R inner;
+				try
+				{
+					inner = func(std::move(*value));
+				}
+				catch (...)
+				{
+					next->SetException(std::current_exception());
+					next->Release();
+					return;
+				}
+
+				//기본 생성된 Future처럼 State가 없으면 기다릴 게 없다.
+				if (inner.IsValid() == false)
+				{
+					next->SetException(std::make_exception_ptr(std::future_error(std::future_errc::no_state)));
+					next->Release();
+					return;
+				}
+
+				inner.OnComplete([next](std::optional<Result>&& innerValue, const std::exception_ptr& innerError)
+				{
+					next->SetResult(std::move(innerValue), innerError);
+					next->Release();
+				});
+			}
+			else
+			{
+				std::optional<Result> newValue;
+				std::exception_ptr newError;
+				try
+				{
+					if constexpr (std::is_void_v<R>)
+					{
+						func(std::move(*value));
+						newValue.emplace();
+					}
+					else
+					{
+						newValue.emplace(func(std::move(*value)));
+					}
+				}
+				catch (...)
+				{
+					newError = std::current_exception();
+				}
+
+				next->SetResult(std::move(newValue), newError);
+				next->Release();
+			}
+		});
+
+		return result;
+	}
+
+private:
+	FutureState<T>* state = nullptr;
+};
+
+//이미 값이 있는 Future
+template<typename T>
+Future<std::decay_t<T>> MakeReadyFuture(T&& value)
+{
+	Promise<std::decay_t<T>> promise;
+	Future<std::decay_t<T>> future = promise.GetFuture();
+	promise.SetValue(std::forward<T>(value));
+	return future;
+}
+
+//pool에서 func()를 부르고 그 결과를 담을 Future를 돌려준다.
+template<typename Func>
+auto Async(ThreadPool& pool, Func&& func)
+{
+	return MakeReadyFuture(Unit{}).Then(pool, [func = std::forward<Func>(func)](Unit) mutable { return func(); });
+}
+
+/////////////
+// WhenAll //
+/////////////
+/*
+	전부 준비되면 순서대로 값을 담은 vector가 준비된다. T는 기본 생성이 가능해야 한다.
+	하나라도 실패하면 전부 끝난 다음 가장 먼저 실패한 것의 예외로 실패한다.
+*/
+template<typename T>
+Future<std::vector<T>> WhenAll(std::vector<Future<T>>&& futures)
+{
+	struct Context
+	{
+		std::vector<T> values;
+		std::atomic<__int32> remaining;
+		std::atomic<bool> failed = false;
+		std::exception_ptr error;
+		Promise<std::vector<T>> promise;
+	};
+
+	const __int32 count = static_cast<__int32>(futures.size());
+	if (count == 0)
+		return MakeReadyFuture(std::vector<T>());
+
+	Context* context = ObjectPool<Context>::Pop();
+	context->values.resize(count);
+	context->remaining.store(count, std::memory_order_relaxed);
+	Future<std::vector<T>> result = context->promise.GetFuture();
+
+	for (__int32 i = 0; i < count; i++)
+	{
+		futures[i].OnComplete([context, i](std::optional<T>&& value, const std::exception_ptr& error)
+		{
+			if (error == nullptr)
+				context->values[i] = std::move(*value);
+			else if (context->failed.exchange(true, std::memory_order_relaxed) == false)
+				context->error = error;
+
+			//마지막으로 끝난 쪽이 모아서 넘긴다. acq_rel이라 다른 스레드가 쓴 값과 에러도 전부 보인다.
+			if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				if (context->error)
+					context->promise.SetException(context->error);
+				else
+					context->promise.SetValue(std::move(context->values));
+				ObjectPool<Context>::Push(context);
+			}
+		});
+	}
+
+	return result;
+}
+
+/////////////
+// WhenAny //
+/////////////
+/*
+	가장 먼저 값이 온 것의 (순번, 값)이 준비된다. 나머지 값은 버린다.
+	실패한 것은 건너뛰고, 전부 실패하면 마지막으로 실패한 것의 예외로 실패한다.
+*/
+template<typename T>
+Future<std::pair<__int32, T>> WhenAny(std::vector<Future<T>>&& futures)
+{
+	struct Context
+	{
+		std::atomic<bool> done = false;
+		std::atomic<__int32> remaining;
+		Promise<std::pair<__int32, T>> promise;
+	};
+
+	//하나도 없으면 값을 넣을 쪽이 없으니 broken_promise로 실패한다.
+	const __int32 count = static_cast<__int32>(futures.size());
+	if (count == 0)
+		return Promise<std::pair<__int32, T>>().GetFuture();
+
+	Context* context = ObjectPool<Context>::Pop();
+	context->remaining.store(count, std::memory_order_relaxed);
+	Future<std::pair<__int32, T>> result = context->promise.GetFuture();
+
+	for (__int32 i = 0; i < count; i++)
+	{
+		futures[i].OnComplete([context, i](std::optional<T>&& value, const std::exception_ptr& error)
+		{
+			if (error == nullptr && context->done.exchange(true, std::memory_order_acq_rel) == false)
+				context->promise.SetValue(std::pair<__int32, T>(i, std::move(*value)));
+
+			//Context는 전부 끝나야 지울 수 있다. 늦게 온 쪽도 done을 봐야 하기 때문.
+			if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				//마지막까지 아무도 값을 넣지 못했으면 전부 실패한 것이다.
+				if (context->done.exchange(true, std::memory_order_acq_rel) == false)
+					context->promise.SetException(error);
+				ObjectPool<Context>::Push(context);
+			}
+		});
+	}
+
+	return result;
+}
@@ -0,0 +1,263 @@
+﻿#pragma once
+
+/*
+	14_LockFree_Stack_1의 LockFreeStack은 Pop 중인 스레드가 나 혼자일 때(popCount == 1)만 노드를 지웠다.
+	Pop하는 스레드가 많아서 혼자가 되는 순간이 거의 없으면 pendingList는 끝도 없이 길어지고 메모리는 계속 늘어난다.
+
+	Hazard Pointer는 "누가 Pop 중인가"가 아니라 "누가 어떤 노드를 보고 있는가"를 본다.
+	1. 노드를 읽기 전에 스레드마다 가진 Hazard 칸에 그 주소를 적어둔다. (나 이거 보고 있으니 지우지 마)
+	2. 다 쓴 노드는 바로 지우지 않고 내 Retire 목록에 넣어둔다.
+	3. Retire 목록이 어느 정도 쌓이면 모든 스레드의 Hazard 칸을 한번에 모아서(Scan)
+	   아무도 적어두지 않은 노드만 지운다.
+
+	Scan 한번에 Hazard 칸 개수(H)보다 많이 지우게 되도록 목록이 2H개쯤 쌓였을 때 Scan을 하기 때문에
+	Retire 한번당 비용은 일정하고, 스레드 하나가 들고 있는 노드 수도 2H개 정도로 묶여서 경합이 아무리 심해도 늘어나지 않는다.
+
+	Memory.h의 GMemory/LMemoryCache처럼 프로그램 전체에 하나(GHazardDomain), 스레드마다 하나(LHazardThread)를 두고
+	자료구조 쪽에서는 HazardPointer로 보호하고 HazardRetire로 넘기기만 하면 된다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+//////////////////
+// HazardDomain //
+//////////////////
+class HazardDomain
+{
+public:
+	enum
+	{
+		SLOT_COUNT = 2,				//스레드 하나가 동시에 보호할 수 있는 포인터 수 (스택은 1개, 큐는 2개면 된다)
+		SCAN_THRESHOLD_MIN = 64		//스레드가 적을 때도 너무 자주 Scan하지 않게 한다.
+	};
+
+	struct Retired
+	{
+		void* ptr;
+		void (*deleter)(void*);
+	};
+
+	//스레드 하나가 쓰는 Hazard 칸과 Retire 목록. 스레드가 끝나면 다음 스레드가 물려받아 쓴다.
+	struct alignas(CACHE_LINE_SIZE) Record
+	{
+		std::atomic<void*> hazards[SLOT_COUNT] = {};
+		std::atomic<bool> active = false;
+		Record* next = nullptr;
+
+		//이 Record를 가진 스레드만 만진다.
+		std::vector<Retired> retired;
+	};
+
+	HazardDomain() = default;
+	HazardDomain(const HazardDomain&) = delete;
+	HazardDomain& operator=(const HazardDomain&) = delete;
+
+	//프로그램이 끝날 때는 보고 있는 스레드가 없으니 남은 것들을 전부 지운다.
+	~HazardDomain()
+	{
+		Record* record = records.load(std::memory_order_acquire);
+		while (record)
+		{
+			Record* next = record->next;
+			for (Retired& retired : record->retired)
+				retired.deleter(retired.ptr);
+			delete record;
+			record = next;
+		}
+	}
+
+	//쉬고 있는 Record가 있으면 가져다 쓰고, 없으면 새로 만들어서 목록 앞에 붙인다.
+	//Record는 Scan하는 스레드가 언제든 읽을 수 있기 때문에 프로그램이 끝날 때까지 지우지 않는다.
+	Record* AcquireRecord()
+	{
+		for (Record* record = records.load(std::memory_order_acquire); record; record = record->next)
+		{
+			bool expected = false;
+			if (record->active.load(std::memory_order_relaxed) == false && record->active.compare_exchange_strong(expected, true, std::memory_order_acquire))
+				return record;
+		}
+
+		Record* record = new Record();
+		record->active.store(true, std::memory_order_relaxed);
+		record->next = records.load(std::memory_order_relaxed);
+		while (records.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed) == false)
+		{
+		}
+		recordCount.fetch_add(1, std::memory_order_relaxed);
+		return record;
+	}
+
+	//스레드가 끝날 때. 남은 Retire 목록은 Record에 그대로 두고 다음에 가져가는 스레드가 이어서 처리한다.
+	void ReleaseRecord(Record* record)
+	{
+		for (std::atomic<void*>& hazard : record->hazards)
+			hazard.store(nullptr, std::memory_order_release);
+
+		Scan(record);
+		record->active.store(false, std::memory_order_release);
+	}
+
+	void Retire(Record* record, void* ptr, void (*deleter)(void*))
+	{
+		record->retired.push_back(Retired{ ptr, deleter });
+		if (static_cast<__int64>(record->retired.size()) >= GetScanThreshold())
+			Scan(record);
+	}
+
+	//모든 스레드의 Hazard 칸을 모아서 아무도 보고 있지 않은 것만 지운다.
+	void Scan(Record* record)
+	{
+		//Retire 하기 전에 자료구조에서 떼어낸 것(CAS)이 Hazard 칸을 읽는 것보다 먼저 보여야 한다.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		std::vector<void*> hazards;
+		hazards.reserve(recordCount.load(std::memory_order_relaxed) * SLOT_COUNT);
+		for (Record* other = records.load(std::memory_order_acquire); other; other = other->next)
+		{
+			for (std::atomic<void*>& hazard : other->hazards)
+			{
+				void* ptr = hazard.load(std::memory_order_seq_cst);
+				if (ptr != nullptr)
+					hazards.push_back(ptr);
+			}
+		}
+		std::sort(hazards.begin(), hazards.end());
+
+		//누가 보고 있는 것은 앞으로 모으고 나머지는 지운다.
+		std::vector<Retired>& retiredList = record->retired;
+		__int64 keepCount = 0;
+		for (Retired& retired : retiredList)
+		{
+			if (std::binary_search(hazards.begin(), hazards.end(), retired.ptr))
+				retiredList[keepCount++] = retired;
+			else
+				retired.deleter(retired.ptr);
+		}
+		retiredList.resize(keepCount);
+	}
+
+	//Hazard 칸 전체 개수의 2배. Scan 한번에 적어도 절반은 지울 수 있다.
+	__int64 GetScanThreshold() const
+	{
+		return (std::max)(static_cast<__int64>(SCAN_THRESHOLD_MIN), 2 * recordCount.load(std::memory_order_relaxed) * SLOT_COUNT);
+	}
+
+private:
+	std::atomic<Record*> records = nullptr;
+	std::atomic<__int64> recordCount = 0;
+};
+
+//프로그램 전체에서 하나만 쓰는 HazardDomain (G는 Global)
+inline HazardDomain GHazardDomain;
+
+//////////////////
+// HazardThread //
+//////////////////
+//스레드마다 하나씩 Record를 들고 있다가 스레드가 끝나면 돌려준다.
+class HazardThread
+{
+public:
+	~HazardThread()
+	{
+		if (record != nullptr)
+			GHazardDomain.ReleaseRecord(record);
+	}
+
+	HazardDomain::Record* GetRecord()
+	{
+		if (record == nullptr)
+			record = GHazardDomain.AcquireRecord();
+		return record;
+	}
+
+	std::atomic<void*>* AcquireSlot()
+	{
+		GetRecord();
+		for (__int32 i = 0; i < HazardDomain::SLOT_COUNT; i++)
+		{
+			if ((usedSlots & (1 << i)) == 0)
+			{
+				usedSlots |= (1 << i);
+				return &record->hazards[i];
+			}
+		}
+
+		//한 스레드가 SLOT_COUNT개보다 많이 보호하려고 했다.
+		CRASH("HAZARD_SLOT_OVERFLOW");
+		return nullptr;
+	}
+
+	void ReleaseSlot(std::atomic<void*>* slot)
+	{
+		usedSlots &= ~(1 << static_cast<__int32>(slot - record->hazards));
+	}
+
+private:
+	HazardDomain::Record* record = nullptr;
+	__int32 usedSlots = 0;
+};
+
+//스레드마다 하나씩 갖는 Hazard 정보 (L은 Local)
+inline thread_local HazardThread LHazardThread;
+
+///////////////////
+// HazardPointer //
+///////////////////
+//Hazard 칸 하나를 빌려서 쓰는 동안만 들고 있는다. 소멸될 때 칸을 비우고 돌려준다.
+class HazardPointer
+{
+public:
+	HazardPointer() : slot(LHazardThread.AcquireSlot()) {}
+
+	~HazardPointer()
+	{
+		slot->store(nullptr, std::memory_order_release);
+		LHazardThread.ReleaseSlot(slot);
+	}
+
+	HazardPointer(const HazardPointer&) = delete;
+	HazardPointer& operator=(const HazardPointer&) = delete;
+
+	/*
+		src가 가리키는 포인터를 Hazard 칸에 적고 돌려준다.
+		적는 사이에 다른 스레드가 src를 바꾸고 지웠을 수도 있기 때문에 적고 나서 src를 다시 읽어서 그대로인지 확인한다.
+		그대로라면 적은 다음에 떼어낸 것이니 Scan하는 스레드는 반드시 내 칸을 보게 된다.
+	*/
+	template<typename T>
+	T* Protect(const std::atomic<T*>& src)
+	{
+		T* ptr = src.load(std::memory_order_relaxed);
+		while (true)
+		{
+			slot->store(ptr, std::memory_order_seq_cst);
+			T* current = src.load(std::memory_order_seq_cst);
+			if (current == ptr)
+				return ptr;
+			ptr = current;
+		}
+	}
+
+	void Reset()
+	{
+		slot->store(nullptr, std::memory_order_release);
+	}
+
+private:
+	std::atomic<void*>* slot;
+};
+
+//자료구조에서 떼어낸 포인터를 넘긴다. 아무도 보고 있지 않게 되면 delete 된다.
+template<typename T>
+void HazardRetire(T* ptr)
+{
+	GHazardDomain.Retire(LHazardThread.GetRecord(), ptr, [](void* p) { delete static_cast<T*>(p); });
+}
+
+//delete 대신 deleter를 부른다. (풀에서 꺼낸 노드를 풀로 돌려보낼 때)
+inline void HazardRetire(void* ptr, void (*deleter)(void*))
+{
+	GHazardDomain.Retire(LHazardThread.GetRecord(), ptr, deleter);
+}
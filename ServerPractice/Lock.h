@@ -0,0 +1,361 @@
+﻿#pragma once
+
+/*
+	04_SpinLock의 SpinLock은 lock을 얻을 때까지 compare_exchange_strong을 쉬지 않고 반복한다.
+	CAS는 실패해도 캐시라인을 쓰기 상태(Exclusive)로 가져와야 해서 기다리는 스레드들이 lock을 쥔 스레드의 캐시라인을 계속 뺏어간다.
+	05_Sleep은 실패하면 100ms를 자는데 lock이 1us 뒤에 풀려도 100ms를 기다려야 한다.
+
+	AdaptiveLock은 잠깐 돌다가(spin) 안되면 잠든다(park).
+	1. 기다릴 때는 CAS 대신 load로 풀렸는지만 본다. (읽기만 하면 캐시라인을 여러 코어가 같이 가질 수 있다, Test and Test-and-Set)
+	   풀린 걸 봤을 때만 CAS를 한다. 실패하면 pause를 1, 2, 4, ... MAX_BACKOFF번으로 늘려가며 쉰다.
+	2. 정해진 횟수(spinLimit)만큼 돌아도 안되면 atomic::wait(리눅스의 futex, 윈도우의 WaitOnAddress)로 잠든다.
+	   state가 2(기다리는 스레드가 있다)일 때만 unlock이 notify_one을 부르기 때문에 아무도 안 기다리면 깨우는 비용이 없다.
+	3. spinLimit은 고정값이 아니다. 돌다가 얻었으면 그때 돈 횟수의 두배 쪽으로, 결국 잠들었으면 절반 쪽으로 조금씩 옮긴다.
+	   lock을 잡고 있는 시간(hold time)이 짧은 lock은 조금만 돌면 되고, 긴 lock은 괜히 돌지 않고 바로 잠든다.
+
+	lock_guard와 같이 쓸 수 있게 lock/unlock/try_lock 이름을 쓴다. (04_SpinLock과 같다)
+
+	읽기/쓰기를 나눠서 잡는 RWSpinLock도 여기에 있다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+//spin 한번마다 CPU에게 "지금 기다리는 중"이라고 알려준다.
+//하이퍼스레딩 형제 코어에 자원을 양보하고, 루프를 빠져나올 때 메모리 순서 때문에 파이프라인을 비우는 비용도 줄어든다.
+inline void CpuPause()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+//////////////////
+// AdaptiveLock //
+//////////////////
+class AdaptiveLock
+{
+public:
+	enum
+	{
+		UNLOCKED = 0,
+		LOCKED = 1,
+		CONTENDED = 2,			//잠들어 있는 스레드가 있을 수 있다.
+
+		MIN_SPIN = 16,
+		MAX_SPIN = 4096,
+		INITIAL_SPIN = 256,
+		MAX_BACKOFF = 64		//한번에 쉬는 최대 pause 수
+	};
+
+	AdaptiveLock() = default;
+	AdaptiveLock(const AdaptiveLock&) = delete;
+	AdaptiveLock& operator=(const AdaptiveLock&) = delete;
+
+	void lock()
+	{
+		__int32 expected = UNLOCKED;
+		if (state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+			return;
+
+		LockSlow();
+	}
+
+	bool try_lock()
+	{
+		__int32 expected = UNLOCKED;
+		return state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed);
+	}
+
+	void unlock()
+	{
+		if (state.exchange(UNLOCKED, std::memory_order_release) == CONTENDED)
+			state.notify_one();
+	}
+
+	__int32 GetSpinLimit() const { return spinLimit.load(std::memory_order_relaxed); }
+
+private:
+	void LockSlow()
+	{
+		const __int32 limit = spinLimit.load(std::memory_order_relaxed);
+		__int32 backoff = 1;
+		__int32 spin = 0;
+
+		while (spin < limit)
+		{
+			if (state.load(std::memory_order_relaxed) == UNLOCKED)
+			{
+				__int32 expected = UNLOCKED;
+				if (state.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed))
+				{
+					//이만큼 돌아서 얻었다. 다음에는 여유있게 두배까지는 돌아본다.
+					Adapt(limit, spin * 2);
+					return;
+				}
+
+				//다른 스레드가 먼저 가져갔다. 다같이 다시 CAS 하지 않게 점점 길게 쉰다.
+				for (__int32 i = 0; i < backoff; i++)
+					CpuPause();
+				spin += backoff;
+				if (backoff < MAX_BACKOFF)
+					backoff <<= 1;
+				continue;
+			}
+
+			CpuPause();
+			spin++;
+		}
+
+		//돌아도 안 풀릴 만큼 오래 잡는 lock이다. 다음에는 덜 돈다.
+		Adapt(limit, limit / 2);
+
+		//CONTENDED로 바꿔놓고 자야 unlock이 깨워준다. exchange가 UNLOCKED를 돌려줬으면 그대로 내가 얻은 것이다.
+		//(그때는 기다리는 스레드가 있는지 모르니 CONTENDED인 채로 둔다. 한번 헛 notify 하는 정도다)
+		while (state.exchange(CONTENDED, std::memory_order_acquire) != UNLOCKED)
+			state.wait(CONTENDED, std::memory_order_relaxed);
+	}
+
+	//한번에 바꾸지 않고 1/8씩만 옮긴다. (어쩌다 한번 길거나 짧았던 걸로 크게 흔들리지 않게)
+	void Adapt(__int32 limit, __int32 target)
+	{
+		if (target < MIN_SPIN)
+			target = MIN_SPIN;
+		if (target > MAX_SPIN)
+			target = MAX_SPIN;
+
+		const __int32 next = limit + (target - limit) / 8;
+		if (next != limit)
+			spinLimit.store(next, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<__int32> state = UNLOCKED;
+
+	//여러 스레드가 대충 써도 된다. (정확한 값일 필요가 없는 추정치)
+	std::atomic<__int32> spinLimit = INITIAL_SPIN;
+};
+
+//////////////
+// ThreadId //
+//////////////
+/*
+	lock 안에 "누가 잡았는지" 적어두기 위한 1부터 시작하는 스레드 번호 (12_TLS의 LThreadID를 처음 쓸 때 자동으로 정한다)
+	RWSpinLock은 번호를 16비트에 넣는다. 번호를 올리기만 하면 스레드를 만들고 지우기를 반복하는 서버는 언젠가 65535를 넘긴다.
+	그래서 스레드가 끝날 때(thread_local의 소멸자) 번호를 돌려받아 다음 스레드에게 다시 준다.
+	번호는 동시에 살아있는 스레드 수만큼만 커진다. lock은 스레드가 처음 번호를 받을 때와 끝날 때만 잡는다.
+*/
+class ThreadIdAllocator
+{
+public:
+	static unsigned __int32 Allocate()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (freeIds.empty())
+			return nextId++;
+
+		const unsigned __int32 id = freeIds.back();
+		freeIds.pop_back();
+		return id;
+	}
+
+	static void Release(unsigned __int32 id)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		freeIds.push_back(id);
+	}
+
+private:
+	static inline std::mutex lock;
+	static inline std::vector<unsigned __int32> freeIds;
+	static inline unsigned __int32 nextId = 1;
+};
+
+//스레드가 끝날 때 번호를 돌려준다.
+struct ThreadIdHolder
+{
+	ThreadIdHolder() : id(ThreadIdAllocator::Allocate()) {}
+	~ThreadIdHolder() { ThreadIdAllocator::Release(id); }
+
+	ThreadIdHolder(const ThreadIdHolder&) = delete;
+	ThreadIdHolder& operator=(const ThreadIdHolder&) = delete;
+
+	unsigned __int32 id;
+};
+
+inline unsigned __int32 GetThreadId()
+{
+	static thread_local ThreadIdHolder LThreadId;
+	return LThreadId.id;
+}
+
+////////////////
+// RWSpinLock //
+////////////////
+/*
+	대부분의 공용 테이블은 쓰는 일보다 읽는 일이 훨씬 많다. 읽기끼리는 서로 막을 필요가 없다.
+	RWSpinLock은 32비트 하나에 상태를 전부 넣고 04_SpinLock처럼 CAS로 잡는다.
+
+	[WWWWWWWW][WWWWWWWW][P][RRRRRRR][RRRRRRRR]
+	W : 쓰기 lock을 잡은 스레드의 GetThreadId() (16비트, 0이면 아무도 안 잡았다)
+	P : 쓰기 lock을 기다리는 스레드가 있다. (Writer Preference)
+	R : 읽기 lock을 잡은 수 (15비트)
+
+	1. ReadLock은 W와 P가 전부 0일 때만 R을 하나 올린다.
+	   P가 켜져 있으면 새로 오는 읽기는 기다린다. 읽기가 끊이지 않아도 쓰기가 영영 못 잡는 일(기아)이 없다.
+	2. WriteLock은 W, R이 전부 0이 될 때까지 P를 켜두고 기다리다가 W에 내 번호를 넣는다.
+	3. 쓰기 lock을 잡은 스레드는 WriteLock, ReadLock을 또 불러도 된다. (재귀)
+	   반대로 읽기 lock만 잡은 채로 WriteLock을 부르면 자기 자신을 기다리게 되니 그러면 안 된다.
+	   읽기 lock을 잡은 채로 ReadLock을 또 부르는 것도 그 사이 쓰기가 P를 켜면 멈춘다. (쓰기 우선이라서)
+	MAX_SPIN_COUNT번 돌아도 안되면 yield로 타임슬라이스를 넘긴다.
+*/
+class RWSpinLock
+{
+public:
+	enum : unsigned __int32
+	{
+		WRITE_OWNER_MASK = 0xFFFF0000,
+		WRITE_PENDING_FLAG = 0x00008000,
+		READ_COUNT_MASK = 0x00007FFF,
+		WRITE_OWNER_SHIFT = 16,
+
+		MAX_SPIN_COUNT = 1024
+	};
+
+	RWSpinLock() = default;
+	RWSpinLock(const RWSpinLock&) = delete;
+	RWSpinLock& operator=(const RWSpinLock&) = delete;
+
+	void WriteLock()
+	{
+		//번호는 재사용되기 때문에 동시에 살아있는 스레드가 65535개를 넘지 않는 한 16비트에 들어간다.
+		const unsigned __int32 threadId = GetThreadId();
+		ASSERT_CRASH(threadId <= (WRITE_OWNER_MASK >> WRITE_OWNER_SHIFT));
+
+		//이미 내가 쓰기 lock을 잡고 있다.
+		if (GetWriteOwner(state.load(std::memory_order_relaxed)) == threadId)
+		{
+			writeCount++;
+			return;
+		}
+
+		const unsigned __int32 desired = threadId << WRITE_OWNER_SHIFT;
+		while (true)
+		{
+			for (unsigned __int32 spin = 0; spin < MAX_SPIN_COUNT; spin++)
+			{
+				unsigned __int32 expected = state.load(std::memory_order_relaxed);
+
+				//W와 R이 비었으면 잡는다. P는 같이 지운다. (아직 기다리는 다른 쓰기가 있으면 그쪽이 다시 켠다)
+				if ((expected & ~WRITE_PENDING_FLAG) == 0)
+				{
+					if (state.compare_exchange_weak(expected, desired, std::memory_order_acquire, std::memory_order_relaxed))
+					{
+						writeCount = 1;
+						return;
+					}
+				}
+				else if ((expected & WRITE_PENDING_FLAG) == 0)
+				{
+					state.fetch_or(WRITE_PENDING_FLAG, std::memory_order_relaxed);
+				}
+
+				CpuPause();
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	void WriteUnlock()
+	{
+		//쓰기 lock 안에서 잡은 읽기 lock을 먼저 풀어야 한다.
+		ASSERT_CRASH((state.load(std::memory_order_relaxed) & READ_COUNT_MASK) == 0);
+
+		if (--writeCount == 0)
+		{
+			//W만 지운다. 그 사이 켜진 P는 남겨둬야 기다리던 쓰기가 새로 오는 읽기보다 먼저 잡는다.
+			state.fetch_and(WRITE_PENDING_FLAG, std::memory_order_release);
+		}
+	}
+
+	void ReadLock()
+	{
+		//쓰기 lock을 잡은 스레드는 그대로 읽어도 된다.
+		if (GetWriteOwner(state.load(std::memory_order_relaxed)) == GetThreadId())
+		{
+			state.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		while (true)
+		{
+			for (unsigned __int32 spin = 0; spin < MAX_SPIN_COUNT; spin++)
+			{
+				//W와 P가 0이라고 기대하고 R만 남긴 값으로 CAS 한다.
+				unsigned __int32 expected = state.load(std::memory_order_relaxed) & READ_COUNT_MASK;
+				if (state.compare_exchange_weak(expected, expected + 1, std::memory_order_acquire, std::memory_order_relaxed))
+					return;
+
+				CpuPause();
+			}
+
+			std::this_thread::yield();
+		}
+	}
+
+	void ReadUnlock()
+	{
+		const unsigned __int32 prev = state.fetch_sub(1, std::memory_order_release);
+		ASSERT_CRASH((prev & READ_COUNT_MASK) != 0);
+	}
+
+private:
+	static unsigned __int32 GetWriteOwner(unsigned __int32 value) { return (value & WRITE_OWNER_MASK) >> WRITE_OWNER_SHIFT; }
+
+private:
+	std::atomic<unsigned __int32> state = 0;
+
+	//쓰기 lock을 잡은 스레드만 만지기 때문에 atomic이 아니어도 된다.
+	unsigned __int32 writeCount = 0;
+};
+
+//lock_guard처럼 범위를 벗어나면 푼다.
+class ReadLockGuard
+{
+public:
+	explicit ReadLockGuard(RWSpinLock& lock) : lock(lock) { lock.ReadLock(); }
+	~ReadLockGuard() { lock.ReadUnlock(); }
+
+	ReadLockGuard(const ReadLockGuard&) = delete;
+	ReadLockGuard& operator=(const ReadLockGuard&) = delete;
+
+private:
+	RWSpinLock& lock;
+};
+
+class WriteLockGuard
+{
+public:
+	explicit WriteLockGuard(RWSpinLock& lock) : lock(lock) { lock.WriteLock(); }
+	~WriteLockGuard() { lock.WriteUnlock(); }
+
+	WriteLockGuard(const WriteLockGuard&) = delete;
+	WriteLockGuard& operator=(const WriteLockGuard&) = delete;
+
+private:
+	RWSpinLock& lock;
+};
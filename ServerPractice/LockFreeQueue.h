@@ -0,0 +1,172 @@
+﻿#pragma once
+
+/*
+	서버에서 실제로 많이 필요한 건 스택보다 먼저 들어온 일을 먼저 처리하는 큐(FIFO)다.
+	LockFreeQueue는 Michael-Scott 큐다.
+	1. 항상 맨 앞에 빈 노드(dummy) 하나를 두기 때문에 head와 tail이 같은 노드를 두고 싸우지 않는다.
+	   (넣는 스레드는 tail만, 빼는 스레드는 head만 CAS 한다)
+	2. 넣을 때는 tail->next를 CAS로 붙이고 나서 tail을 옮긴다.
+	   tail을 옮기기 전에 다른 스레드가 오면 그 스레드가 대신 tail을 옮겨주고 진행한다. (누구도 멈춰서 기다리지 않는다)
+	3. 뺄 때는 head->next의 값을 가져가고 head를 next로 옮긴다. next가 새 dummy가 되고 옛날 head는 버린다.
+
+	노드는 new 대신 노드 전용 MemoryPool의 SList(SList.h)에서 꺼내고
+	버린 노드는 Reclaim(Reclaim.h)이 안전하다고 할 때 SList로 돌려보낸다.
+	풀로 돌아간 노드는 바로 다른 노드로 재사용되기 때문에 Reclaim 없이 돌려보내면 ABA 문제가 생긴다.
+
+	ObjectPool을 쓰지 않는 이유는 노드를 돌려보내는 시점 때문이다.
+	Reclaim은 스레드가 끝날 때(TLS 소멸자)나 프로그램이 끝날 때(GHazardDomain 소멸자) 남은 노드를 돌려보내는데
+	그때는 ObjectPool의 TLS 캐시나 풀이 이미 사라졌을 수 있다. 그래서 TLS 없이 풀의 SList에 바로 넣는다.
+*/
+
+#include "Reclaim.h"
+#include "MemoryPool.h"
+#include "CachePadded.h"
+#include <atomic>
+#include <new>
+#include <utility>
+
+template<typename T, typename Reclaim = HazardReclaim>
+class LockFreeQueue
+{
+	struct alignas(SLIST_ALIGNMENT) Node
+	{
+		T* Data() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+		std::atomic<Node*> next = nullptr;
+
+		//dummy 노드는 값이 없기 때문에 값은 넣을 때 만들고 꺼낼 때 소멸시킨다.
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+public:
+	LockFreeQueue()
+	{
+		Node* dummy = AllocateNode();
+		head.store(dummy, std::memory_order_relaxed);
+		tail.store(dummy, std::memory_order_relaxed);
+	}
+
+	//다른 스레드가 쓰고 있지 않다고 가정한다.
+	~LockFreeQueue()
+	{
+		Node* node = head.load(std::memory_order_relaxed);
+		Node* next = node->next.load(std::memory_order_relaxed);
+		ReleaseNode(node);
+
+		while (next)
+		{
+			node = next;
+			next = node->next.load(std::memory_order_relaxed);
+			node->Data()->~T();
+			ReleaseNode(node);
+		}
+	}
+
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	template<typename U>
+	void Push(U&& value)
+	{
+		Node* node = AllocateNode();
+		new(node->Data())T(std::forward<U>(value));
+
+		typename Reclaim::Guard guard;
+		while (true)
+		{
+			Node* last = guard.Protect(tail);
+			Node* next = last->next.load(std::memory_order_acquire);
+			if (last != tail.load(std::memory_order_acquire))
+				continue;
+
+			if (next != nullptr)
+			{
+				//누가 붙여놓고 tail을 아직 안 옮겼다. 대신 옮겨준다.
+				tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+				continue;
+			}
+
+			Node* expected = nullptr;
+			if (last->next.compare_exchange_weak(expected, node, std::memory_order_release, std::memory_order_relaxed))
+			{
+				//실패해도 괜찮다. 다른 스레드가 옮겨준 것이다.
+				tail.compare_exchange_strong(last, node, std::memory_order_release, std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		//head와 head->next를 둘 다 보호해야 해서 Guard가 두개 필요하다.
+		typename Reclaim::Guard headGuard;
+		typename Reclaim::Guard nextGuard;
+		while (true)
+		{
+			Node* first = headGuard.Protect(head);
+			Node* last = tail.load(std::memory_order_acquire);
+			Node* next = nextGuard.Protect(first->next);
+
+			//first를 보호하기 전에 이미 빠져나간 노드라면 next도 믿을 수 없다.
+			if (first != head.load(std::memory_order_acquire))
+				continue;
+
+			if (next == nullptr)
+				return false;
+
+			if (first == last)
+			{
+				//tail이 뒤처져 있다. 옮겨주고 다시 한다.
+				tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+				continue;
+			}
+
+			if (head.compare_exchange_weak(first, next, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				//next는 이제 dummy다. 값을 꺼내가는 건 head를 옮긴 나뿐이다.
+				value = std::move(*next->Data());
+				next->Data()->~T();
+
+				headGuard.Reset();
+				Reclaim::Retire(first, &ReleaseNode);
+				return true;
+			}
+		}
+	}
+
+	//다른 스레드가 계속 넣고 빼는 중이라면 부르는 순간 이미 바뀌어 있을 수 있다. (참고용)
+	bool IsEmpty()
+	{
+		typename Reclaim::Guard guard;
+		Node* first = guard.Protect(head);
+		return first->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	/*
+		노드 전용 풀. GHazardDomain, GEpochDomain이 프로그램이 끝날 때 남은 노드를 여기로 돌려보내는데
+		전역 변수끼리는 소멸 순서를 정할 수 없어서 풀이 먼저 사라지면 안 된다. 그래서 일부러 지우지 않는다.
+	*/
+	static MemoryPool& GetNodePool()
+	{
+		static MemoryPool* pool = new MemoryPool(sizeof(Node));
+		return *pool;
+	}
+
+	static Node* AllocateNode()
+	{
+		return new(GetNodePool().Pop())Node();
+	}
+
+	static void ReleaseNode(void* ptr)
+	{
+		Node* node = static_cast<Node*>(ptr);
+		node->~Node();
+		GetNodePool().Push(reinterpret_cast<MemoryHeader*>(node));
+	}
+
+private:
+	//넣는 쪽과 빼는 쪽이 서로의 캐시라인을 건드리지 않게 떨어뜨려 놓는다.
+	CachePadded<std::atomic<Node*>> head = nullptr;
+	CachePadded<std::atomic<Node*>> tail = nullptr;
+};
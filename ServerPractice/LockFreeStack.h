@@ -0,0 +1,270 @@
+﻿#pragma once
+
+/*
+	14, 15_LockFree_Stack과 32_HazardPointer에서 노드를 언제 지워도 되는지(메모리 회수) 방법을 세가지 봤다.
+	스택 알고리즘은 그대로 두고 회수 방법만 바꿔 끼울 수 있도록 LockFreeStack<T, Reclaim>으로 만든다.
+
+	1. HazardReclaim  : Reclaim.h
+	2. EpochReclaim   : Reclaim.h
+	3. SplitRefCount  : 15_LockFree_Stack_2의 외부/내부 참조 카운트. head 자체가 달라서 따로 특수화했다.
+
+	세번째 인자 Backoff에 EliminationArray(Elimination.h)를 넣으면 head CAS가 자꾸 실패할 때
+	Push와 TryPop이 head를 거치지 않고 노드를 직접 주고받는다. 기본값 NoElimination은 아무것도 하지 않는다.
+*/
+
+#include "Reclaim.h"
+#include "Elimination.h"
+#include "AtomicPair.h"
+#include "CachePadded.h"
+#include <atomic>
+#include <utility>
+
+///////////////////
+// SplitRefCount //
+///////////////////
+//LockFreeStack을 특수화하기 위한 이름표
+struct SplitRefCount
+{
+	//다른 Reclaim과 모양을 맞추기 위한 것. 참조 카운트는 연산마다 따로 하기 때문에 하는 일이 없다.
+	class Guard
+	{
+	public:
+		Guard() {}
+	};
+};
+
+///////////////////
+// LockFreeStack //
+///////////////////
+template<typename T, typename Reclaim, typename Backoff = NoElimination>
+class LockFreeStack
+{
+	struct Node
+	{
+		Node(const T& value) : data(value) {}
+
+		T data;
+		Node* next = nullptr;
+	};
+
+public:
+	LockFreeStack() = default;
+	LockFreeStack(const LockFreeStack&) = delete;
+	LockFreeStack& operator=(const LockFreeStack&) = delete;
+
+	//다른 스레드가 쓰고 있지 않다고 가정한다.
+	~LockFreeStack()
+	{
+		Node* node = head.load(std::memory_order_relaxed);
+		while (node)
+		{
+			Node* next = node->next;
+			delete node;
+			node = next;
+		}
+	}
+
+	void Push(const T& value)
+	{
+		Node* node = new Node(value);
+		node->next = head.load(std::memory_order_relaxed);
+		__int32 failCount = 0;
+		while (head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed) == false)
+		{
+			//경합이 심하면 head에 올리는 대신 TryPop에게 노드를 바로 넘겨본다.
+			if (++failCount >= Backoff::FAIL_THRESHOLD && backoff.TryGive(node))
+				return;
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		typename Reclaim::Guard guard;
+		Node* oldHead = nullptr;
+		__int32 failCount = 0;
+		while (true)
+		{
+			//CAS가 실패하면 다시 Protect 해야 새 head가 보호된다.
+			oldHead = guard.Protect(head);
+			if (oldHead == nullptr)
+				return false;
+
+			if (head.compare_exchange_strong(oldHead, oldHead->next, std::memory_order_acquire, std::memory_order_relaxed))
+				break;
+
+			if (++failCount >= Backoff::FAIL_THRESHOLD)
+			{
+				//Push가 넘겨준 노드는 head에 올라간 적이 없어서 다른 스레드가 볼 수 없다. 바로 지워도 된다.
+				if (Node* node = static_cast<Node*>(backoff.TryTake()))
+				{
+					value = std::move(node->data);
+					delete node;
+					return true;
+				}
+			}
+		}
+
+		//떼어낸 노드는 내 것이지만 TryPeek 중인 스레드가 아직 읽고 있을 수 있어서 옮기지 않고 복사한다.
+		value = oldHead->data;
+		guard.Reset();
+		Reclaim::Retire(oldHead);
+		return true;
+	}
+
+	//꺼내지 않고 맨 위의 값만 읽는다.
+	bool TryPeek(T& value)
+	{
+		typename Reclaim::Guard guard;
+		Node* top = guard.Protect(head);
+		if (top == nullptr)
+			return false;
+
+		value = top->data;
+		return true;
+	}
+
+	//Elimination으로 주고받은 횟수
+	__int64 GetEliminatedCount() const { return backoff.GetEliminatedCount(); }
+
+private:
+	//스택을 여러개 나란히 두거나 다른 변수 옆에 둬도 head가 캐시라인을 혼자 쓰게 한다.
+	CachePadded<std::atomic<Node*>> head = nullptr;
+	Backoff backoff;
+};
+
+/*
+	15_LockFree_Stack_2의 방식 그대로다.
+	head는 (externalCount, node)를 합친 16바이트라서 std::atomic 대신 AtomicPair.h의 AtomicTaggedPtr로 바꾼다.
+	(std::atomic<16바이트 구조체>는 gcc에서 lock free가 아니다)
+	head를 읽기만 하려고 해도 externalCount를 올리는 128비트 CAS를 해야 해서 TryPeek도 비싸다.
+*/
+template<typename T, typename Backoff>
+class LockFreeStack<T, SplitRefCount, Backoff>
+{
+	struct Node;
+
+	//tag가 외부 참조 카운트(externalCount)다.
+	using CountedNodePtr = TaggedPtr<Node>;
+
+	struct Node
+	{
+		Node(const T& value) : data(value) {}
+
+		T data;
+		CountedNodePtr next;
+		std::atomic<__int32> internalCount = 0;
+	};
+
+	//DWCAS가 없는 플랫폼에서는 tag가 16비트라서 참조 카운트를 담기에 모자라다.
+	static_assert(AtomicTaggedPtr<Node>::TAG_BITS >= 32, "SplitRefCount는 16바이트 CAS(DWCAS)가 되는 플랫폼에서만 쓸 수 있다.");
+
+public:
+	LockFreeStack() = default;
+	LockFreeStack(const LockFreeStack&) = delete;
+	LockFreeStack& operator=(const LockFreeStack&) = delete;
+
+	~LockFreeStack()
+	{
+		Node* node = head.LoadRelaxed().ptr;
+		while (node)
+		{
+			Node* next = node->next.ptr;
+			delete node;
+			node = next;
+		}
+	}
+
+	void Push(const T& value)
+	{
+		CountedNodePtr newHead;
+		newHead.ptr = new Node(value);
+		newHead.tag = 1;
+		newHead.ptr->next = head.LoadRelaxed();
+		__int32 failCount = 0;
+		while (head.CompareExchange(newHead.ptr->next, newHead) == false)
+		{
+			if (++failCount >= Backoff::FAIL_THRESHOLD && backoff.TryGive(newHead.ptr))
+				return;
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		CountedNodePtr oldHead = head.LoadRelaxed();
+		__int32 failCount = 0;
+		while (true)
+		{
+			IncreaseHeadCount(oldHead);
+
+			Node* ptr = oldHead.ptr;
+			if (ptr == nullptr)
+				return false;
+
+			if (head.CompareExchange(oldHead, ptr->next))
+			{
+				value = ptr->data;
+
+				//나(1)와 head에 있던 몫(1)을 빼고 나머지는 아직 보고 있는 스레드들이다.
+				const __int32 countIncrease = static_cast<__int32>(oldHead.tag - 2);
+				if (ptr->internalCount.fetch_add(countIncrease) == -countIncrease)
+					delete ptr;
+
+				return true;
+			}
+			else if (ptr->internalCount.fetch_sub(1) == 1)
+			{
+				delete ptr;
+			}
+
+			//넘겨받은 노드는 아무도 참조 카운트를 올린 적이 없다.
+			if (++failCount >= Backoff::FAIL_THRESHOLD)
+			{
+				if (Node* node = static_cast<Node*>(backoff.TryTake()))
+				{
+					value = std::move(node->data);
+					delete node;
+					return true;
+				}
+			}
+		}
+	}
+
+	bool TryPeek(T& value)
+	{
+		CountedNodePtr oldHead = head.LoadRelaxed();
+		IncreaseHeadCount(oldHead);
+
+		Node* ptr = oldHead.ptr;
+		if (ptr == nullptr)
+			return false;
+
+		value = ptr->data;
+
+		//소유권을 못 가져간 TryPop과 똑같이 내 몫만 돌려준다.
+		if (ptr->internalCount.fetch_sub(1) == 1)
+			delete ptr;
+
+		return true;
+	}
+
+	__int64 GetEliminatedCount() const { return backoff.GetEliminatedCount(); }
+
+private:
+	void IncreaseHeadCount(CountedNodePtr& oldCounter)
+	{
+		while (true)
+		{
+			CountedNodePtr newCounter = oldCounter;
+			newCounter.tag++;
+			if (head.CompareExchange(oldCounter, newCounter))
+			{
+				oldCounter.tag = newCounter.tag;
+				break;
+			}
+		}
+	}
+
+private:
+	CachePadded<AtomicTaggedPtr<Node>> head;
+	Backoff backoff;
+};
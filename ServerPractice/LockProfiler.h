@@ -0,0 +1,379 @@
+﻿#pragma once
+
+/*
+	03_Mutex, 04_SpinLock처럼 lock_guard로 잡는 곳이 많아지면 어느 lock이 실제로 시간을 잡아먹는지 알기 어렵다.
+	PROFILED_LOCK_GUARD(lock)을 lock_guard<...> guard(lock) 대신 쓰면 그 자리(call site)마다
+	1. lock을 얻기까지 기다린 시간(wait)
+	2. lock을 잡고 있던 시간(hold)
+	을 CPU 클럭(rdtsc)으로 재서 2의 거듭제곱 구간별 히스토그램에 쌓는다.
+
+	자리는 std::source_location(파일, 줄, 함수)과 lock 식의 이름으로 구분하고 처음 지나갈 때 한번만 등록한다.
+	카운터는 MemoryStats(MemoryStats.h)와 같이 스레드마다 따로 두고 GetReport를 부를 때만 모아서 합친다.
+	잡을 때마다 드는 비용은 rdtsc 두번(바로 못 잡았으면 세번)과 내 스레드 카운터에 더하기 몇번이다.
+	(가상 머신에서는 rdtsc가 하이퍼바이저로 넘어가서 한번에 수십 ns가 걸리기도 한다)
+	LOCK_PROFILE을 0으로 정의하면 PROFILED_LOCK_GUARD는 그냥 std::lock_guard가 된다. (아무것도 남지 않는다)
+*/
+
+#include "Types.h"
+#include "MemoryStats.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <mutex>
+#include <source_location>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#if !defined(LOCK_PROFILE)
+#define LOCK_PROFILE 1
+#endif
+
+//CPU 클럭 수. rdtsc가 없는 CPU에서는 steady_clock의 나노초로 대신한다. (비율은 GetReport에서 맞춘다)
+inline unsigned __int64 ReadTsc()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<unsigned __int64>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+///////////////////
+// LockSiteStats //
+///////////////////
+//자리 하나의 통계 (모든 스레드를 합친 값)
+struct LockSiteStats
+{
+	enum { BUCKET_COUNT = 40 };		//bucket i에는 [2^(i-1), 2^i) 클럭이 들어간다.
+
+	std::string name;				//PROFILED_LOCK_GUARD에 넘긴 식
+	std::string file;
+	__int32 line = 0;
+	std::string function;
+
+	__int64 acquireCount = 0;
+	__int64 totalWaitCycles = 0;
+	__int64 totalHoldCycles = 0;
+	__int64 maxWaitCycles = 0;
+	__int64 maxHoldCycles = 0;
+	__int64 waitHistogram[BUCKET_COUNT] = {};
+	__int64 holdHistogram[BUCKET_COUNT] = {};
+
+	//히스토그램에서 ratio 지점이 들어있는 구간의 끝 (대충의 백분위수)
+	static __int64 GetPercentile(const __int64 (&histogram)[BUCKET_COUNT], __int64 count, double ratio)
+	{
+		const __int64 target = static_cast<__int64>(count * ratio);
+		__int64 seen = 0;
+		for (__int32 i = 0; i < BUCKET_COUNT; i++)
+		{
+			seen += histogram[i];
+			if (seen > target)
+				return i == 0 ? 0 : (1LL << i) - 1;
+		}
+		return 0;
+	}
+};
+
+////////////////
+// LockReport //
+////////////////
+struct LockReport
+{
+	std::vector<LockSiteStats> sites;		//기다린 시간 합이 큰 순서
+	double cyclesPerMicrosecond = 1.0;
+
+	std::string ToText() const
+	{
+		std::string text;
+		char buffer[512];
+		snprintf(buffer, sizeof(buffer), "%-24s %-24s %10s %12s %10s %10s %10s %10s %10s\n",
+			"lock", "site", "acquires", "wait total", "wait avg", "wait p99", "wait max", "hold avg", "hold p99");
+		text += buffer;
+
+		for (const LockSiteStats& site : sites)
+		{
+			if (site.acquireCount == 0)
+				continue;
+
+			const std::string where = ShortFileName(site.file) + ":" + std::to_string(site.line);
+			snprintf(buffer, sizeof(buffer), "%-24s %-24s %10lld %9.0f us %7.3f us %7.3f us %7.1f us %7.3f us %7.3f us\n",
+				site.name.c_str(), where.c_str(), site.acquireCount,
+				ToMicroseconds(site.totalWaitCycles),
+				ToMicroseconds(site.totalWaitCycles) / site.acquireCount,
+				ToMicroseconds(LockSiteStats::GetPercentile(site.waitHistogram, site.acquireCount, 0.99)),
+				ToMicroseconds(site.maxWaitCycles),
+				ToMicroseconds(site.totalHoldCycles) / site.acquireCount,
+				ToMicroseconds(LockSiteStats::GetPercentile(site.holdHistogram, site.acquireCount, 0.99)));
+			text += buffer;
+		}
+
+		return text;
+	}
+
+private:
+	double ToMicroseconds(__int64 cycles) const { return cycles / cyclesPerMicrosecond; }
+
+	static std::string ShortFileName(const std::string& path)
+	{
+		const size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+};
+
+//////////////////////
+// LockSiteCounters //
+//////////////////////
+//스레드 하나가 자리 하나에 대해 들고 있는 카운터
+struct LockSiteCounters
+{
+	void Record(__int64 waitCycles, __int64 holdCycles)
+	{
+		acquireCount.Add(1);
+		totalWaitCycles.Add(waitCycles);
+		totalHoldCycles.Add(holdCycles);
+		maxWaitCycles.Max(waitCycles);
+		maxHoldCycles.Max(holdCycles);
+		waitHistogram[ToBucket(waitCycles)].Add(1);
+		holdHistogram[ToBucket(holdCycles)].Add(1);
+	}
+
+	void MergeTo(LockSiteStats& stats) const
+	{
+		stats.acquireCount += acquireCount.Get();
+		stats.totalWaitCycles += totalWaitCycles.Get();
+		stats.totalHoldCycles += totalHoldCycles.Get();
+		stats.maxWaitCycles = std::max(stats.maxWaitCycles, maxWaitCycles.Get());
+		stats.maxHoldCycles = std::max(stats.maxHoldCycles, maxHoldCycles.Get());
+		for (__int32 i = 0; i < LockSiteStats::BUCKET_COUNT; i++)
+		{
+			stats.waitHistogram[i] += waitHistogram[i].Get();
+			stats.holdHistogram[i] += holdHistogram[i].Get();
+		}
+	}
+
+	static __int32 ToBucket(__int64 cycles)
+	{
+		const __int32 bucket = static_cast<__int32>(std::bit_width(static_cast<unsigned __int64>(cycles)));
+		return bucket < LockSiteStats::BUCKET_COUNT ? bucket : LockSiteStats::BUCKET_COUNT - 1;
+	}
+
+	StatCounter acquireCount;
+	StatCounter totalWaitCycles;
+	StatCounter totalHoldCycles;
+	StatCounter maxWaitCycles;
+	StatCounter maxHoldCycles;
+	StatCounter waitHistogram[LockSiteStats::BUCKET_COUNT];
+	StatCounter holdHistogram[LockSiteStats::BUCKET_COUNT];
+};
+
+class LockProfileThread;
+
+//////////////////
+// LockProfiler //
+//////////////////
+class LockProfiler
+{
+public:
+	enum
+	{
+		MAX_SITE_COUNT = 1024
+	};
+
+	LockProfiler() : startTsc(ReadTsc()), startTime(std::chrono::steady_clock::now()) {}
+
+	//자리마다 처음 한번만 불린다. (PROFILED_LOCK_GUARD 안의 static)
+	__int32 RegisterSite(const char* name, const std::source_location& location)
+	{
+		std::lock_guard<std::mutex> lock(sitesLock);
+		ASSERT_CRASH(static_cast<__int32>(sites.size()) < MAX_SITE_COUNT);
+
+		LockSiteStats site;
+		site.name = name;
+		site.file = location.file_name();
+		site.line = static_cast<__int32>(location.line());
+		site.function = location.function_name();
+		sites.push_back(site);
+		return static_cast<__int32>(sites.size()) - 1;
+	}
+
+	//모든 스레드의 카운터를 합쳐서 기다린 시간이 긴 순서로 돌려준다. 다른 스레드가 lock을 잡는 중에 불러도 된다.
+	LockReport GetReport();
+
+	void RegisterThread(LockProfileThread* thread);
+	void UnregisterThread(LockProfileThread* thread);
+
+private:
+	std::mutex sitesLock;
+	std::vector<LockSiteStats> sites;			//등록된 자리와 끝난 스레드들이 남기고 간 통계
+	std::vector<LockProfileThread*> threads;	//살아있는 스레드들
+
+	//rdtsc 클럭을 시간으로 바꾸기 위한 기준점
+	const unsigned __int64 startTsc;
+	const std::chrono::steady_clock::time_point startTime;
+};
+
+///////////////////////
+// LockProfileThread //
+///////////////////////
+class LockProfileThread
+{
+public:
+	LockProfileThread();
+	~LockProfileThread();
+
+	LockProfileThread(const LockProfileThread&) = delete;
+	LockProfileThread& operator=(const LockProfileThread&) = delete;
+
+	void Record(__int32 siteId, __int64 waitCycles, __int64 holdCycles)
+	{
+		LockSiteCounters* site = sites[siteId].load(std::memory_order_relaxed);
+		if (site == nullptr)
+		{
+			//이 스레드가 이 자리를 처음 지나간다. GetReport가 동시에 읽을 수 있어서 다 만든 다음에 올린다.
+			site = new LockSiteCounters();
+			sites[siteId].store(site, std::memory_order_release);
+		}
+
+		site->Record(waitCycles, holdCycles);
+	}
+
+	//sitesLock을 잡은 상태에서 호출된다.
+	void MergeTo(std::vector<LockSiteStats>& stats) const
+	{
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			if (LockSiteCounters* site = sites[i].load(std::memory_order_acquire))
+				site->MergeTo(stats[i]);
+		}
+	}
+
+private:
+	std::atomic<LockSiteCounters*> sites[LockProfiler::MAX_SITE_COUNT] = {};
+};
+
+//프로그램 전체에서 하나 (G는 Global), 스레드마다 하나 (L은 Local)
+inline LockProfiler GLockProfiler;
+inline thread_local LockProfileThread LLockProfileThread;
+
+inline LockReport LockProfiler::GetReport()
+{
+	LockReport report;
+	{
+		std::lock_guard<std::mutex> lock(sitesLock);
+		report.sites = sites;
+		for (LockProfileThread* thread : threads)
+			thread->MergeTo(report.sites);
+	}
+
+	std::sort(report.sites.begin(), report.sites.end(), [](const LockSiteStats& a, const LockSiteStats& b)
+	{
+		return a.totalWaitCycles > b.totalWaitCycles;
+	});
+
+	const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+	if (elapsed.count() > 0)
+		report.cyclesPerMicrosecond = static_cast<double>(ReadTsc() - startTsc) / elapsed.count();
+
+	return report;
+}
+
+inline void LockProfiler::RegisterThread(LockProfileThread* thread)
+{
+	std::lock_guard<std::mutex> lock(sitesLock);
+	threads.push_back(thread);
+}
+
+inline void LockProfiler::UnregisterThread(LockProfileThread* thread)
+{
+	std::lock_guard<std::mutex> lock(sitesLock);
+	thread->MergeTo(sites);
+	threads.erase(std::find(threads.begin(), threads.end(), thread));
+}
+
+inline LockProfileThread::LockProfileThread()
+{
+	GLockProfiler.RegisterThread(this);
+}
+
+inline LockProfileThread::~LockProfileThread()
+{
+	GLockProfiler.UnregisterThread(this);
+
+	for (std::atomic<LockSiteCounters*>& site : sites)
+		delete site.load(std::memory_order_relaxed);
+}
+
+///////////////////////
+// ProfiledLockGuard //
+///////////////////////
+//lock_guard와 같지만 기다린 시간과 잡고 있던 시간을 잰다. 보통은 PROFILED_LOCK_GUARD로 쓴다.
+template<typename Lock>
+class ProfiledLockGuard
+{
+public:
+	ProfiledLockGuard(Lock& lock, __int32 siteId) : lock(lock), siteId(siteId)
+	{
+		//try_lock이 있는 lock은 바로 잡혔으면 기다린 시간이 0이니 rdtsc 한번을 아낀다.
+		if constexpr (requires { lock.try_lock(); })
+		{
+			if (lock.try_lock())
+			{
+				acquireTsc = ReadTsc();
+				return;
+			}
+		}
+
+		const unsigned __int64 start = ReadTsc();
+		lock.lock();
+		acquireTsc = ReadTsc();
+		waitCycles = static_cast<__int64>(acquireTsc - start);
+	}
+
+	~ProfiledLockGuard()
+	{
+		const __int64 holdCycles = static_cast<__int64>(ReadTsc() - acquireTsc);
+		lock.unlock();
+
+		//기록은 lock을 푼 다음에 한다. (잡고 있는 시간을 늘리지 않게)
+		LLockProfileThread.Record(siteId, waitCycles, holdCycles);
+	}
+
+	ProfiledLockGuard(const ProfiledLockGuard&) = delete;
+	ProfiledLockGuard& operator=(const ProfiledLockGuard&) = delete;
+
+private:
+	Lock& lock;
+	const __int32 siteId;
+	unsigned __int64 acquireTsc = 0;
+	__int64 waitCycles = 0;
+};
+
+/*
+	PROFILED_LOCK_GUARD(spinLock); 은 lock_guard<SpinLock> guard(spinLock); 과 같다.
+	람다는 쓰인 자리마다 다른 타입이라 그 안의 static도 자리마다 하나씩 생긴다. 그래서 등록은 자리마다 한번뿐이다.
+	변수 이름은 __COUNTER__를 붙여서 매번 다르게 만든다. 한 범위 안에서 lock 두개를 차례로 잡아도 이름이 겹치지 않는다.
+*/
+#define LOCK_PROFILE_CONCAT_INNER(a, b) a##b
+#define LOCK_PROFILE_CONCAT(a, b) LOCK_PROFILE_CONCAT_INNER(a, b)
+#define LOCK_PROFILE_GUARD_NAME LOCK_PROFILE_CONCAT(profiledLockGuard, __COUNTER__)
+
+#if LOCK_PROFILE
+#define PROFILED_LOCK_GUARD(lock)																	\
+	ProfiledLockGuard<std::remove_reference_t<decltype(lock)>> LOCK_PROFILE_GUARD_NAME(lock,		\
+		[](const std::source_location& location)													\
+		{																							\
+			static const __int32 siteId = GLockProfiler.RegisterSite(#lock, location);				\
+			return siteId;																			\
+		}(std::source_location::current()))
+#else
+#define PROFILED_LOCK_GUARD(lock)																	\
+	std::lock_guard<std::remove_reference_t<decltype(lock)>> LOCK_PROFILE_GUARD_NAME(lock)
+#endif
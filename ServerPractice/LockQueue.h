@@ -0,0 +1,284 @@
+﻿#pragma once
+
+/*
+	13_LockBased_Stack_Queue에서 만든 LockStack, LockQueue를 다른 파일에서도 쓰기 위해 헤더로 옮겼다.
+	mutex 하나로 std::stack, std::queue 전체를 감싸고 condition_variable로 기다린다.
+*/
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <stack>
+#include <queue>
+
+/*
+	WaitPop처럼 하나씩 꺼내면 원소 하나마다 lock 한번, notify 한번을 쓰게 된다.
+	Consumer가 한번 깨어났을 때 쌓여있는걸 다 가져갈 수 있도록 PopAll/WaitPopAll을 두고
+	Producer도 여러개를 한번의 lock으로 넣을 수 있도록 PushBulk를 둔다.
+	notify는 lock을 풀고 나서 한다. lock을 쥔 채로 깨우면 깨어난 스레드가 바로 lock에 막혀서 다시 잠들기 때문.
+*/
+
+///////////////
+// LockStack //
+///////////////
+template<typename T>
+class LockStack
+{
+public:
+	LockStack() = default;
+	LockStack(const LockStack&) = delete;
+	LockStack& operator=(const LockStack&) = delete;
+
+	void Push(T val)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stack.push(std::move(val));
+		}
+		cv.notify_one();
+	}
+
+	//[first, last)를 lock 한번에 전부 넣는다. (원소들은 move 된다)
+	template<typename Iterator>
+	void PushBulk(Iterator first, Iterator last)
+	{
+		size_t count = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (; first != last; ++first, ++count)
+				stack.push(std::move(*first));
+		}
+
+		if (count == 1)
+			cv.notify_one();
+		else if (count > 1)
+			cv.notify_all();
+	}
+
+	bool TryPop(T& val)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stack.empty())
+			return false;
+
+		val = std::move(stack.top());
+
+		stack.pop();
+		return true;
+	}
+
+	void WaitPop(T& val)
+	{
+		//람다 안에서 멤버를 쓰기 때문에 this를 캡처해야 한다.
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this] { return stack.empty() == false; });
+		val = std::move(stack.top());
+		stack.pop();
+	}
+
+	//timeout 안에 꺼내지 못하면 false
+	template<typename Rep, typename Period>
+	bool WaitPopFor(T& val, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (cv.wait_for(lock, timeout, [this] { return stack.empty() == false; }) == false)
+			return false;
+
+		val = std::move(stack.top());
+		stack.pop();
+		return true;
+	}
+
+	//들어있는걸 통째로 바꿔치기해서 가져온다. lock 안에서는 swap만 한다. (out의 top이 가장 마지막에 들어온 원소)
+	size_t PopAll(std::stack<T>& out)
+	{
+		std::stack<T> empty;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stack.swap(empty);
+		}
+
+		out.swap(empty);
+		return out.size();
+	}
+
+	//하나라도 들어올 때까지 기다렸다가 PopAll
+	size_t WaitPopAll(std::stack<T>& out)
+	{
+		std::stack<T> empty;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return stack.empty() == false; });
+			stack.swap(empty);
+		}
+
+		out.swap(empty);
+		return out.size();
+	}
+
+private:
+	std::stack<T> stack;
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+
+///////////////
+// LockQueue //
+///////////////
+template<typename T>
+class LockQueue
+{
+public:
+	/*
+		스레드를 재우지 않고 기다리는 쪽(Coroutine.h의 PopAsync)을 위한 대기표.
+		큐가 비어있을 때 TryPopOrWait로 걸어두면 다음 Push가 값을 value에 바로 넣어주고 lock 밖에서 Wake를 부른다.
+	*/
+	struct PopWaiter
+	{
+		T* value = nullptr;
+		void (*Wake)(PopWaiter* waiter) = nullptr;
+	};
+
+	LockQueue() = default;
+	LockQueue(const LockQueue&) = delete;
+	LockQueue& operator = (const LockQueue&) = delete;
+
+	//T&로 받아서 push하면 복사가 일어난다. 값으로 받아서 move 한다.
+	void Push(T val)
+	{
+		PopWaiter* waiter = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (waiters.empty())
+			{
+				queue.push(std::move(val));
+			}
+			else
+			{
+				//기다리던 대기표가 있으면 큐를 거치지 않고 바로 넘겨준다.
+				waiter = waiters.front();
+				waiters.pop();
+				*waiter->value = std::move(val);
+			}
+		}
+
+		if (waiter)
+			waiter->Wake(waiter);
+		else
+			cv.notify_one();
+	}
+
+	//[first, last)를 lock 한번에 전부 넣는다. (원소들은 move 된다)
+	template<typename Iterator>
+	void PushBulk(Iterator first, Iterator last)
+	{
+		size_t count = 0;
+		std::queue<PopWaiter*> woken;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (; first != last; ++first)
+			{
+				if (waiters.empty())
+				{
+					queue.push(std::move(*first));
+					count++;
+					continue;
+				}
+
+				PopWaiter* waiter = waiters.front();
+				waiters.pop();
+				*waiter->value = std::move(*first);
+				woken.push(waiter);
+			}
+		}
+
+		for (; woken.empty() == false; woken.pop())
+			woken.front()->Wake(woken.front());
+
+		if (count == 1)
+			cv.notify_one();
+		else if (count > 1)
+			cv.notify_all();
+	}
+
+	bool TryPop(T& val)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty())
+			return false;
+
+		val = std::move(queue.front());
+
+		queue.pop();
+		return true;
+	}
+
+	//꺼낼게 있으면 *waiter->value에 꺼내고 true, 없으면 waiter를 걸어두고 false (Wake는 다음 Push가 부른다)
+	bool TryPopOrWait(PopWaiter* waiter)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.empty())
+		{
+			waiters.push(waiter);
+			return false;
+		}
+
+		*waiter->value = std::move(queue.front());
+		queue.pop();
+		return true;
+	}
+
+	void WaitPop(T& val)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this] { return queue.empty() == false; });
+		val = std::move(queue.front());
+		queue.pop();
+	}
+
+	//timeout 안에 꺼내지 못하면 false
+	template<typename Rep, typename Period>
+	bool WaitPopFor(T& val, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (cv.wait_for(lock, timeout, [this] { return queue.empty() == false; }) == false)
+			return false;
+
+		val = std::move(queue.front());
+		queue.pop();
+		return true;
+	}
+
+	//들어있는걸 통째로 바꿔치기해서 가져온다. lock 안에서는 swap만 하고 원래 out에 있던건 lock 밖에서 버린다.
+	size_t PopAll(std::queue<T>& out)
+	{
+		std::queue<T> empty;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.swap(empty);
+		}
+
+		out.swap(empty);
+		return out.size();
+	}
+
+	//하나라도 들어올 때까지 기다렸다가 PopAll
+	size_t WaitPopAll(std::queue<T>& out)
+	{
+		std::queue<T> empty;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return queue.empty() == false; });
+			queue.swap(empty);
+		}
+
+		out.swap(empty);
+		return out.size();
+	}
+
+private:
+	std::queue<T> queue;
+	std::queue<PopWaiter*> waiters;
+	std::mutex mutex;
+	std::condition_variable cv;
+};
@@ -0,0 +1,289 @@
+﻿#pragma once
+
+/*
+	13_LockBased_Stack_Queue의 LockQueue는 std::queue 전체를 mutex 하나로 감싼다.
+	그러면 넣는 스레드(Producer)와 빼는 스레드(Consumer)가 몇개든 한번에 한 스레드만 큐를 만질 수 있다.
+
+	MPMCQueue(Multi Producer Multi Consumer)는 크기가 정해진 원형 배열(Ring Buffer)을 쓰는 lock free 큐다. (Dmitry Vyukov의 방식)
+	1. 칸(Slot)마다 sequence 번호가 있어서 그 칸이 지금 "넣을 차례"인지 "뺄 차례"인지를 알려준다.
+	   - sequence == pos     : 비어있다. pos번째로 넣는 스레드가 써도 된다.
+	   - sequence == pos + 1 : 차있다. pos번째로 빼는 스레드가 가져가도 된다.
+	   - 다 빼고 나면 sequence = pos + capacity가 되어서 한바퀴 뒤에 넣을 스레드를 기다린다.
+	2. 넣는 스레드는 tail을, 빼는 스레드는 head를 CAS로 하나씩 올려서 자기 칸을 정한다.
+	   자기 칸을 정한 다음에는 그 칸을 혼자 쓰기 때문에 데이터를 옮기는 동안에는 다른 스레드와 싸우지 않는다.
+	3. head와 tail은 서로 다른 스레드들이 계속 고치는 값이라 캐시라인을 따로 쓰게 떨어뜨려 놓는다. (False Sharing 방지)
+
+	큐가 비어있을 때 기다리는 WaitPop, 꽉 찼을 때 기다리는 Push는 condition_variable 대신 atomic::wait(리눅스의 futex, 윈도우의 WaitOnAddress)를 쓴다.
+	mutex가 없으니 기다리는 스레드가 없으면 깨우는 비용도 없다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <new>
+#include <utility>
+
+template<typename T>
+class MPMCQueue
+{
+public:
+	//capacity는 2의 거듭제곱으로 올림한다. (pos % capacity를 pos & mask로 하기 위해)
+	explicit MPMCQueue(__int32 capacity)
+	{
+		this->capacity = 2;
+		while (this->capacity < static_cast<unsigned __int64>(capacity))
+			this->capacity <<= 1;
+		mask = this->capacity - 1;
+
+		slots = new Slot[this->capacity];
+		for (unsigned __int64 i = 0; i < this->capacity; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	//아무도 안 꺼내간 데이터는 소멸자만 불러준다. (다른 스레드가 쓰고 있지 않다고 가정한다)
+	~MPMCQueue()
+	{
+		const unsigned __int64 end = tail.load(std::memory_order_relaxed);
+		for (unsigned __int64 pos = head.load(std::memory_order_relaxed); pos != end; pos++)
+		{
+			Slot& slot = slots[pos & mask];
+			if (slot.sequence.load(std::memory_order_relaxed) == pos + 1)
+				slot.Data()->~T();
+		}
+		delete[] slots;
+	}
+
+	MPMCQueue(const MPMCQueue&) = delete;
+	MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+	//꽉 차 있으면 false
+	template<typename U>
+	bool TryPush(U&& value)
+	{
+		unsigned __int64 pos = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& slot = slots[pos & mask];
+			const unsigned __int64 sequence = slot.sequence.load(std::memory_order_acquire);
+			const __int64 diff = static_cast<__int64>(sequence - pos);
+
+			if (diff == 0)
+			{
+				//비어있는 칸이다. 내가 가져가도록 tail을 올려본다.
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					new(slot.Data())T(std::forward<U>(value));
+					slot.sequence.store(pos + 1, std::memory_order_release);
+					NotifyConsumers(false);
+					return true;
+				}
+				//실패하면 pos에 새 tail이 들어와 있으니 다시 시도한다.
+			}
+			else if (diff < 0)
+			{
+				//한바퀴 전의 데이터를 아직 아무도 안 가져갔다. 꽉 찼다.
+				return false;
+			}
+			else
+			{
+				//다른 스레드가 먼저 이 칸을 가져갔다.
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	//비어있으면 false
+	bool TryPop(T& value)
+	{
+		unsigned __int64 pos = head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Slot& slot = slots[pos & mask];
+			const unsigned __int64 sequence = slot.sequence.load(std::memory_order_acquire);
+			const __int64 diff = static_cast<__int64>(sequence - (pos + 1));
+
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = std::move(*slot.Data());
+					slot.Data()->~T();
+					slot.sequence.store(pos + capacity, std::memory_order_release);
+					NotifyProducers(false);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				//아직 아무도 안 넣었다. 비어있다.
+				return false;
+			}
+			else
+			{
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/*
+		여러개를 한번에 넣는다. 실제로 넣은 개수를 리턴한다. (values에서 move 해간다)
+		tail부터 연달아 비어있는 칸을 세어서 tail을 그만큼 한번에 올리기 때문에 CAS 한번으로 여러 칸을 가져간다.
+		세는 동안 다른 스레드가 그 칸을 가져가려면 tail을 먼저 올려야 하니 CAS가 성공했다면 센 칸은 전부 내 것이다.
+	*/
+	__int32 TryPushBatch(T* values, __int32 count)
+	{
+		unsigned __int64 pos = tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			__int32 ready = 0;
+			while (ready < count && slots[(pos + ready) & mask].sequence.load(std::memory_order_acquire) == pos + ready)
+				ready++;
+
+			if (ready == 0)
+			{
+				//첫 칸부터 못 쓰면 꽉 찼거나 다른 스레드가 tail을 올린 것이다.
+				const unsigned __int64 current = tail.load(std::memory_order_relaxed);
+				if (current == pos)
+					return 0;
+				pos = current;
+				continue;
+			}
+
+			if (tail.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+			{
+				for (__int32 i = 0; i < ready; i++)
+				{
+					Slot& slot = slots[(pos + i) & mask];
+					new(slot.Data())T(std::move(values[i]));
+					slot.sequence.store(pos + i + 1, std::memory_order_release);
+				}
+				NotifyConsumers(ready > 1);
+				return ready;
+			}
+		}
+	}
+
+	//최대 maxCount개를 한번에 꺼낸다. 실제로 꺼낸 개수를 리턴한다.
+	__int32 TryPopBatch(T* values, __int32 maxCount)
+	{
+		unsigned __int64 pos = head.load(std::memory_order_relaxed);
+		while (true)
+		{
+			__int32 ready = 0;
+			while (ready < maxCount && slots[(pos + ready) & mask].sequence.load(std::memory_order_acquire) == pos + ready + 1)
+				ready++;
+
+			if (ready == 0)
+			{
+				const unsigned __int64 current = head.load(std::memory_order_relaxed);
+				if (current == pos)
+					return 0;
+				pos = current;
+				continue;
+			}
+
+			if (head.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+			{
+				for (__int32 i = 0; i < ready; i++)
+				{
+					Slot& slot = slots[(pos + i) & mask];
+					values[i] = std::move(*slot.Data());
+					slot.Data()->~T();
+					slot.sequence.store(pos + i + capacity, std::memory_order_release);
+				}
+				NotifyProducers(ready > 1);
+				return ready;
+			}
+		}
+	}
+
+	//꽉 차 있으면 자리가 날 때까지 기다렸다가 넣는다.
+	template<typename U>
+	void Push(U&& value)
+	{
+		while (TryPush(std::forward<U>(value)) == false)
+			Wait(producerWaitCount, popSignal, [&]() { return IsFull() == false; });
+	}
+
+	//비어있으면 들어올 때까지 기다렸다가 꺼낸다.
+	void WaitPop(T& value)
+	{
+		while (TryPop(value) == false)
+			Wait(consumerWaitCount, pushSignal, [&]() { return IsEmpty() == false; });
+	}
+
+	//다른 스레드가 계속 넣고 빼는 중이라면 부르는 순간 이미 바뀌어 있을 수 있다. (참고용)
+	bool IsEmpty() const
+	{
+		const unsigned __int64 pos = head.load(std::memory_order_relaxed);
+		return static_cast<__int64>(slots[pos & mask].sequence.load(std::memory_order_acquire) - (pos + 1)) < 0;
+	}
+
+	bool IsFull() const
+	{
+		const unsigned __int64 pos = tail.load(std::memory_order_relaxed);
+		return static_cast<__int64>(slots[pos & mask].sequence.load(std::memory_order_acquire) - pos) < 0;
+	}
+
+	__int32 GetCapacity() const { return static_cast<__int32>(capacity); }
+
+private:
+	struct Slot
+	{
+		T* Data() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+		std::atomic<unsigned __int64> sequence;
+		alignas(T) unsigned char storage[sizeof(T)];
+	};
+
+	/*
+		기다리는 쪽 : 대기 수를 올리고 -> signal 값을 기억하고 -> 다시 확인하고 -> signal이 바뀔 때까지 잔다.
+		깨우는 쪽   : 데이터를 넣고(빼고) -> 대기 수를 확인해서 0이 아니면 signal을 올리고 깨운다.
+		양쪽 다 "내가 쓰고 나서 상대방 것을 읽는" 구조라 둘 사이에 seq_cst 순서가 보장되어야 깨우는 걸 놓치지 않는다.
+		(기다리는 쪽이 다시 확인했을 때 비어있었다면 깨우는 쪽은 아직 넣기 전이고, 넣은 다음에는 대기 수가 보인다)
+	*/
+	template<typename Ready>
+	static void Wait(std::atomic<__int32>& waitCount, std::atomic<unsigned __int32>& signal, Ready ready)
+	{
+		waitCount.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const unsigned __int32 old = signal.load(std::memory_order_seq_cst);
+		if (ready() == false)
+			signal.wait(old, std::memory_order_seq_cst);
+		waitCount.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	//여러개를 넣고 뺐을 때는 기다리는 스레드를 전부 깨운다.
+	static void Notify(std::atomic<__int32>& waitCount, std::atomic<unsigned __int32>& signal, bool all)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waitCount.load(std::memory_order_relaxed) == 0)
+			return;
+
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		if (all)
+			signal.notify_all();
+		else
+			signal.notify_one();
+	}
+
+	void NotifyConsumers(bool all) { Notify(consumerWaitCount, pushSignal, all); }
+	void NotifyProducers(bool all) { Notify(producerWaitCount, popSignal, all); }
+
+private:
+	Slot* slots = nullptr;
+	unsigned __int64 capacity = 0;
+	unsigned __int64 mask = 0;
+
+	//넣는 쪽과 빼는 쪽이 서로의 캐시라인을 건드리지 않게 떨어뜨려 놓는다.
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned __int64> tail = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<unsigned __int64> head = 0;
+
+	//넣고 뺄 때마다 읽기만 하고 기다릴 때만 고치기 때문에 head, tail과는 따로 둔다.
+	alignas(CACHE_LINE_SIZE) std::atomic<__int32> producerWaitCount = 0;
+	std::atomic<__int32> consumerWaitCount = 0;
+	std::atomic<unsigned __int32> popSignal = 0;
+	std::atomic<unsigned __int32> pushSignal = 0;
+
+	//뒤에 오는 다른 변수가 head와 같은 캐시라인에 들어오지 않게 한다.
+	alignas(CACHE_LINE_SIZE) char padding = 0;
+};
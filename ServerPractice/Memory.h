@@ -0,0 +1,338 @@
+﻿#pragma once
+
+/*
+	22_MemoryPool1의 Memory는 Allocate/Release를 할 때마다 공용 MemoryPool로 간다.
+	그러면 스레드가 많아질수록 모든 스레드가 풀 하나의 lock과 allocCount를 가지고 싸우게 된다.
+	그래서 12_TLS에서 봤던 thread_local을 이용해서 스레드마다 작은 보관함(Magazine)을 하나씩 둔다.
+	1. Allocate는 먼저 내 Magazine에서 꺼내고, 비어있을 때만 공용 풀에서 BATCH_SIZE개를 한번에 가져온다.
+	2. Release는 먼저 내 Magazine에 넣고, 꽉 찼을 때만 BATCH_SIZE개를 한번에 공용 풀에 돌려준다.
+	Magazine은 나만 쓰는 공간이기 때문에 lock도 atomic도 필요없다.
+
+	크기별 할당 통계(MemoryStats.h)도 스레드마다 MemoryCache에 따로 세고, GetStats()를 부를 때만 모아서 합친다.
+*/
+
+#include "MemoryPool.h"
+#include "MemoryStats.h"
+#include "SizeClass.h"
+#include <vector>
+#include <algorithm>
+
+class MemoryCache;
+
+//요청 크기에 MemoryHeader를 더해서 풀을 찾기 때문에 가장 작은 풀이 헤더보다 작거나 같으면 그 풀은 아무도 쓰지 않는다.
+static_assert(SizeClass::ToSize(0) > sizeof(MemoryHeader), "SizeClass::SKIP_COUNT를 MemoryHeader 크기에 맞게 고쳐야 한다.");
+
+////////////
+// Memory //
+////////////
+class Memory
+{
+public:
+	enum
+	{
+		//크기 구간은 SizeClass.h에서 컴파일 타임에 정해진다. (32, 48, 64, 80, 96, 112, 128, 160 ... 4096)
+		POOL_COUNT = SizeClass::COUNT,
+		MAX_ALLOC_SIZE = SizeClass::MAX_SIZE //이 사이즈보다 크면 풀을 이용하지 않고 malloc/free를 함
+	};
+
+	Memory()
+	{
+		//풀의 번호는 SizeClass::ToIndex로 바로 계산되기 때문에 크기 -> 풀 표를 따로 만들 필요가 없다.
+		//TLS 캐시도 같은 번호로 Magazine을 찾는다.
+		for (__int32 poolIndex = 0; poolIndex < POOL_COUNT; poolIndex++)
+			pools[poolIndex] = new MemoryPool(SizeClass::ToSize(poolIndex));
+
+		exitedStats.sizeClasses.resize(POOL_COUNT);
+	}
+
+	~Memory()
+	{
+		for (MemoryPool* pool : pools)
+			delete pool;
+	}
+
+	//TLS 캐시를 거쳐서 할당/해제 (일반적으로 쓰는 경로)
+	void* Allocate(__int32 size);
+	void Release(void* ptr);
+
+	//TLS 캐시 없이 공용 풀로 바로 가는 경로 (캐시가 없을 때와 비교하기 위함)
+	void* AllocateNoCache(__int32 size)
+	{
+		MemoryHeader* header = nullptr;
+		const __int32 allocSize = size + sizeof(MemoryHeader);
+
+		if (allocSize > MAX_ALLOC_SIZE)
+			header = reinterpret_cast<MemoryHeader*>(malloc(allocSize));
+		else
+			header = pools[SizeClass::ToIndex(allocSize)]->Pop();
+
+		return MemoryHeader::AttachHeader(header, allocSize);
+	}
+
+	void ReleaseNoCache(void* ptr)
+	{
+		MemoryHeader* header = MemoryHeader::DetachHeader(ptr);
+		const __int32 allocSize = header->allocSize;
+
+		if (allocSize > MAX_ALLOC_SIZE)
+			free(header);
+		else
+			pools[SizeClass::ToIndex(allocSize)]->Push(header);
+	}
+
+	//다 쓰고 풀에 돌아와 있는 Slab들을 해제한다.
+	//스레드의 TLS 캐시가 들고 있는 블록은 풀에 돌아온게 아니기 때문에 그 블록이 속한 Slab은 해제되지 않는다.
+	__int32 Trim()
+	{
+		__int32 releaseCount = 0;
+		for (MemoryPool* pool : pools)
+			releaseCount += pool->Trim();
+
+		return releaseCount;
+	}
+
+	//모든 스레드의 통계를 합쳐서 돌려준다. 다른 스레드가 할당하는 중에 불러도 된다.
+	MemoryStats GetStats();
+
+	//MemoryCache가 생성/소멸될 때 스스로 등록/해제한다.
+	void RegisterCache(MemoryCache* cache);
+	void UnregisterCache(MemoryCache* cache);
+
+private:
+	MemoryPool* pools[POOL_COUNT];
+
+	std::mutex statsLock;
+	std::vector<MemoryCache*> caches;	//살아있는 스레드들의 캐시
+	MemoryStats exitedStats;			//끝난 스레드들이 남기고 간 통계
+
+	//큰 할당은 어차피 malloc까지 가기 때문에 전역 atomic 하나 정도는 부담이 되지 않는다.
+	std::atomic<__int64> largeOutstandingBytes = 0;
+	std::atomic<__int64> largePeakBytes = 0;
+};
+
+//////////////
+// Magazine //
+//////////////
+//스레드 하나가 풀 하나에 대해 들고 있는 블록 보관함
+class Magazine
+{
+public:
+	enum
+	{
+		MAGAZINE_SIZE = 64,						//스레드가 들고 있을 수 있는 최대 블록 수
+		BATCH_SIZE = MemoryPool::BATCH_SIZE		//공용 풀과 한번에 주고받는 블록 수
+	};
+
+	MemoryHeader* Pop(MemoryPool* pool)
+	{
+		if (count == 0)
+		{
+			//비어있으면 공용 풀에서 한번에 채워온다. (공용 풀에 가는건 여기서 뿐이다)
+			this->pool = pool;
+			pool->PopBatch(headers, BATCH_SIZE);
+			count = BATCH_SIZE;
+		}
+
+		return headers[--count];
+	}
+
+	void Push(MemoryPool* pool, MemoryHeader* header)
+	{
+		if (count == MAGAZINE_SIZE)
+		{
+			//꽉 찼으면 위쪽 절반을 공용 풀에 돌려준다.
+			//전부 돌려주지 않는 이유는 바로 다음 Pop에서 다시 풀로 가는 상황(핑퐁)을 막기 위해서다.
+			count -= BATCH_SIZE;
+			pool->PushBatch(&headers[count], BATCH_SIZE);
+		}
+
+		this->pool = pool;
+		headers[count++] = header;
+	}
+
+	__int32 GetCount() const { return count; }
+
+	//들고 있던 블록들을 전부 공용 풀에 돌려준다.
+	void Flush()
+	{
+		if (count > 0)
+			pool->PushBatch(headers, count);
+		count = 0;
+	}
+
+private:
+	MemoryPool* pool = nullptr;
+	__int32 count = 0;
+	MemoryHeader* headers[MAGAZINE_SIZE];
+};
+
+/////////////////
+// MemoryCache //
+/////////////////
+class MemoryCache
+{
+public:
+	MemoryCache();
+
+	//스레드가 끝날 때 들고 있던 블록들을 전부 공용 풀에 돌려준다.
+	//돌려주지 않으면 그 스레드가 들고 있던 메모리는 아무도 못 쓰게 된다.
+	~MemoryCache();
+
+	//size는 사용자가 요청한 크기 (통계용)
+	MemoryHeader* Pop(__int32 poolIndex, MemoryPool* pool, __int32 size)
+	{
+#if MEMORY_STATS
+		SizeClassCounters& counters = sizeClassCounters[poolIndex];
+		counters.allocCount.Add(1);
+		counters.allocBytes.Add(size);
+		if (magazines[poolIndex].GetCount() == 0)
+			counters.missCount.Add(1);
+#endif
+		return magazines[poolIndex].Pop(pool);
+	}
+
+	void Push(__int32 poolIndex, MemoryPool* pool, MemoryHeader* header, __int32 size)
+	{
+#if MEMORY_STATS
+		SizeClassCounters& counters = sizeClassCounters[poolIndex];
+		counters.releaseCount.Add(1);
+		counters.releaseBytes.Add(size);
+		if (magazines[poolIndex].GetCount() == Magazine::MAGAZINE_SIZE)
+			counters.spillCount.Add(1);
+#endif
+		magazines[poolIndex].Push(pool, header);
+	}
+
+	void RecordLargeAlloc(__int32 size)
+	{
+#if MEMORY_STATS
+		largeCounters.allocCount.Add(1);
+		largeCounters.allocBytes.Add(size);
+		largeCounters.maxSize.Max(size);
+#endif
+	}
+
+	void RecordLargeRelease(__int32 size)
+	{
+#if MEMORY_STATS
+		largeCounters.releaseCount.Add(1);
+		largeCounters.releaseBytes.Add(size);
+#endif
+	}
+
+	//statsLock을 잡은 상태에서 호출된다.
+	void MergeTo(MemoryStats& stats) const
+	{
+		for (__int32 i = 0; i < Memory::POOL_COUNT; i++)
+			sizeClassCounters[i].MergeTo(stats.sizeClasses[i]);
+		largeCounters.MergeTo(stats.large);
+	}
+
+private:
+	Magazine magazines[Memory::POOL_COUNT];
+
+	SizeClassCounters sizeClassCounters[Memory::POOL_COUNT];
+	LargeAllocCounters largeCounters;
+};
+
+//스레드마다 하나씩 갖는 캐시 (L은 Local, 12_TLS의 LThreadID와 같은 규칙)
+inline thread_local MemoryCache LMemoryCache;
+
+//프로그램 전체에서 하나만 쓰는 Memory (G는 Global)
+inline Memory GMemory;
+
+inline void* Memory::Allocate(__int32 size)
+{
+	MemoryHeader* header = nullptr;
+	const __int32 allocSize = size + sizeof(MemoryHeader);
+
+	if (allocSize > MAX_ALLOC_SIZE)
+	{
+		header = reinterpret_cast<MemoryHeader*>(malloc(allocSize));
+#if MEMORY_STATS
+		LMemoryCache.RecordLargeAlloc(size);
+
+		const __int64 outstanding = largeOutstandingBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		__int64 peak = largePeakBytes.load(std::memory_order_relaxed);
+		while (outstanding > peak && largePeakBytes.compare_exchange_weak(peak, outstanding, std::memory_order_relaxed) == false)
+		{
+		}
+#endif
+	}
+	else
+	{
+		const __int32 poolIndex = SizeClass::ToIndex(allocSize);
+		header = LMemoryCache.Pop(poolIndex, pools[poolIndex], size);
+	}
+
+	return MemoryHeader::AttachHeader(header, allocSize);
+}
+
+inline void Memory::Release(void* ptr)
+{
+	MemoryHeader* header = MemoryHeader::DetachHeader(ptr);
+	const __int32 allocSize = header->allocSize;
+	const __int32 size = allocSize - static_cast<__int32>(sizeof(MemoryHeader));
+
+	if (allocSize > MAX_ALLOC_SIZE)
+	{
+		free(header);
+#if MEMORY_STATS
+		LMemoryCache.RecordLargeRelease(size);
+		largeOutstandingBytes.fetch_sub(size, std::memory_order_relaxed);
+#endif
+	}
+	else
+	{
+		const __int32 poolIndex = SizeClass::ToIndex(allocSize);
+		LMemoryCache.Push(poolIndex, pools[poolIndex], header, size);
+	}
+}
+
+inline MemoryStats Memory::GetStats()
+{
+	MemoryStats stats;
+	{
+		std::lock_guard<std::mutex> lock(statsLock);
+		stats = exitedStats;
+		for (MemoryCache* cache : caches)
+			cache->MergeTo(stats);
+		stats.liveThreadCount = static_cast<__int32>(caches.size());
+	}
+
+	for (__int32 i = 0; i < POOL_COUNT; i++)
+	{
+		stats.sizeClasses[i].blockSize = pools[i]->GetAllocSize();
+		stats.sizeClasses[i].peakBlockCount = pools[i]->GetPeakAllocCount();
+	}
+	stats.large.peakBytes = largePeakBytes.load(std::memory_order_relaxed);
+
+	return stats;
+}
+
+inline void Memory::RegisterCache(MemoryCache* cache)
+{
+	std::lock_guard<std::mutex> lock(statsLock);
+	caches.push_back(cache);
+}
+
+inline void Memory::UnregisterCache(MemoryCache* cache)
+{
+	std::lock_guard<std::mutex> lock(statsLock);
+	cache->MergeTo(exitedStats);
+	exitedStats.exitedThreadCount++;
+	caches.erase(std::find(caches.begin(), caches.end(), cache));
+}
+
+inline MemoryCache::MemoryCache()
+{
+	GMemory.RegisterCache(this);
+}
+
+inline MemoryCache::~MemoryCache()
+{
+	for (Magazine& magazine : magazines)
+		magazine.Flush();
+
+	GMemory.UnregisterCache(this);
+}
@@ -0,0 +1,406 @@
+﻿#pragma once
+
+/*
+	22_MemoryPool1에서 만들었던 메모리 풀을 여러 파일에서 같이 쓰기 위해 헤더로 옮겼다.
+	구조는 똑같이 [Memory Header][Data] 이다.
+	다른 점이 있다면 TLS 캐시(Memory.h)가 여러개를 한번에 가져가고 돌려줄 수 있게 Batch 함수를 추가했다는 것과
+	23_MemoryPool2에서 얘기했던 두가지 아쉬운 점을 고쳤다는 것이다.
+	1. std::queue + lock 대신 lock free인 SList(SList.h)를 사용한다.
+	2. SListEntry를 MemoryHeader 안에 넣어서 반납된 블록 자체가 리스트의 노드가 된다.
+	   그래서 풀이 블록을 관리하기 위해 따로 메모리를 할당할 일이 없다.
+	3. 블록이 모자랄 때 하나씩 malloc하지 않고 큰 덩어리(Slab)를 할당받아서 잘라 쓴다.
+	   같은 크기의 블록들이 메모리상에 붙어있게 되니 캐시와 TLB 입장에서도 유리하다.
+*/
+
+#include "Types.h"
+#include "SList.h"
+#include "CachePadded.h"
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <cstdlib>
+
+//MemoryHeader는 16바이트다. (SListEntry의 next 8바이트 + union 8바이트)
+//풀에 반납되어 있는 동안에는 next(와 batchNext)를, 사용중일 때는 allocSize를 쓴다.
+struct MemoryHeader : public SListEntry
+{
+	MemoryHeader(__int32 size) : allocSize(size) {}
+
+	static void* AttachHeader(MemoryHeader* header, __int32 size)
+	{
+		new(header)MemoryHeader(size);
+		return reinterpret_cast<void*>(++header);
+	}
+
+	static MemoryHeader* DetachHeader(void* ptr)
+	{
+		MemoryHeader* header = reinterpret_cast<MemoryHeader*>(ptr) - 1;
+		return header;
+	}
+
+	union
+	{
+		__int32 allocSize;			//사용중일 때 : 할당받은 크기
+		MemoryHeader* batchNext;	//풀에 묶음으로 들어가 있을 때 : 묶음 안의 다음 블록
+	};
+};
+
+//블록은 16바이트 단위로 정렬되어 있다. 헤더 크기도 16의 배수여야 사용자에게 주는 주소가 malloc처럼 16바이트로 정렬된다.
+static_assert(sizeof(MemoryHeader) % SLIST_ALIGNMENT == 0, "MemoryHeader 뒤의 데이터가 16바이트로 정렬되지 않는다.");
+
+//Slab은 자기 크기 단위로 정렬되어 있어야 블록의 주소만 보고 어느 Slab에 속해있는지 알 수 있다.
+inline void* AlignedMalloc(size_t size, size_t alignment)
+{
+#if defined(_MSC_VER)
+	return ::_aligned_malloc(size, alignment);
+#else
+	return ::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+}
+
+inline void AlignedFree(void* ptr)
+{
+#if defined(_MSC_VER)
+	::_aligned_free(ptr);
+#else
+	::free(ptr);
+#endif
+}
+
+/*
+	Slab은 블록 여러개를 한번에 담고 있는 큰 메모리 덩어리다.
+	[Slab][Block][Block][Block]...[Block]
+	맨 앞에는 Slab의 정보가 있고 그 뒤는 전부 같은 크기의 블록이다.
+*/
+struct alignas(SLIST_ALIGNMENT) Slab
+{
+	Slab* next;				//풀이 가지고 있는 Slab 목록
+	__int32 blockCount;		//이 Slab에 들어있는 블록 수
+	__int32 freeCount;		//Trim을 할 때 풀에 돌아와 있는 블록 수를 세는 용도
+};
+
+//SListHeader를 CachePadded로 감싸서 MemoryPool 전체가 캐시라인 단위로 정렬된다. (16바이트 정렬도 같이 보장된다)
+class MemoryPool
+{
+public:
+	enum
+	{
+		BATCH_SIZE = 32,				//TLS 캐시와 한번에 주고받는 블록 수
+		DEFAULT_SLAB_SIZE = 64 * 1024,	//64KB (윈도우의 VirtualAlloc 할당 단위와 같다)
+		MIN_BLOCK_PER_SLAB = 8,			//Slab 하나에 최소한 이만큼은 블록이 들어가게 한다.
+		TRIM_SPIN_COUNT = 1024			//Trim이 Pop중인 스레드를 기다려주는 최대 횟수
+	};
+
+	//slabSize는 2의 거듭제곱으로 올림해서 쓴다. (주소에서 Slab을 찾을 때 비트 연산을 하기 위해)
+	MemoryPool(__int32 allocSize, __int32 slabSize = DEFAULT_SLAB_SIZE) : allocSize(allocSize)
+	{
+		//풀에 있는 동안 블록에 MemoryHeader(next, batchNext)를 쓰기 때문에 그보다 작으면 옆 블록을 덮어쓴다.
+		//MemoryHeader는 16바이트다.
+		if (this->allocSize < static_cast<__int32>(sizeof(MemoryHeader)))
+			this->allocSize = static_cast<__int32>(sizeof(MemoryHeader));
+
+		//블록마다 (헤더 뒤의) 데이터가 16바이트로 정렬되도록 크기도 16바이트 단위로 올림한다.
+		this->allocSize = (this->allocSize + SLIST_ALIGNMENT - 1) & ~(SLIST_ALIGNMENT - 1);
+
+		InitializeHead(&header);
+		InitializeHead(&batchHeader);
+
+		this->slabSize = SLIST_ALIGNMENT;
+		while (this->slabSize < slabSize || (this->slabSize - sizeof(Slab)) / this->allocSize < MIN_BLOCK_PER_SLAB)
+			this->slabSize <<= 1;
+	}
+	~MemoryPool()
+	{
+		//아직 누가 쓰고 있는 블록이 있더라도 풀이 사라지면 전부 돌려준다.
+		while (slabs != nullptr)
+		{
+			Slab* next = slabs->next;
+			AlignedFree(slabs);
+			slabs = next;
+		}
+	}
+
+	//메모리가 필요없어서 Pool에 반납할 때는 Push
+	void Push(MemoryHeader* ptr)
+	{
+		PushEntryList(&header, static_cast<SListEntry*>(ptr));
+
+		allocCount.fetch_sub(1);
+	}
+
+	//메모리가 필요해서 Pool에서 가져올 때는 Pop을 쓴다.
+	MemoryHeader* Pop()
+	{
+		popCount.fetch_add(1);
+		MemoryHeader* memory = static_cast<MemoryHeader*>(PopEntryList(&header));
+		MemoryHeader* batch = nullptr;
+		if (memory == nullptr)
+			batch = static_cast<MemoryHeader*>(PopEntryList(&batchHeader));
+		popCount.fetch_sub(1);
+
+		//낱개가 없어서 묶음을 뜯었으면 첫 블록만 쓰고 나머지는 낱개 리스트에 넣어둔다.
+		if (batch != nullptr)
+		{
+			memory = batch;
+			batch = batch->batchNext;
+
+			if (batch != nullptr)
+			{
+				MemoryHeader* first = batch;
+				for (; batch->batchNext != nullptr; batch = batch->batchNext)
+					batch->next = batch->batchNext;
+
+				PushEntryListChain(&header, first, batch);
+			}
+		}
+
+		//만약 여분이 없으면 Slab을 하나 만들어서 쪼개 쓴다.
+		if (memory == nullptr)
+			AllocateSlab(&memory, 1);
+
+		UpdatePeak(allocCount.fetch_add(1) + 1);
+
+		return memory;
+	}
+
+	/*
+		TLS 캐시가 넘치면 여러개를 한번에 반납한다.
+		블록을 하나씩 SList에 넣고 빼면 블록마다 CAS를 한번씩 하게 되니
+		BATCH_SIZE개짜리 묶음은 batchNext로 엮어서 묶음 전용 SList(batchHeader)에 통째로 넣는다.
+		그러면 묶음 하나를 넣고 빼는게 CAS 한번으로 끝난다.
+	*/
+	void PushBatch(MemoryHeader** headers, __int32 count)
+	{
+		if (count == BATCH_SIZE)
+		{
+			for (__int32 i = 0; i < count - 1; i++)
+				headers[i]->batchNext = headers[i + 1];
+			headers[count - 1]->batchNext = nullptr;
+
+			PushEntryList(&batchHeader, headers[0]);
+		}
+		else
+		{
+			for (__int32 i = 0; i < count - 1; i++)
+				headers[i]->next = headers[i + 1];
+
+			PushEntryListChain(&header, headers[0], headers[count - 1]);
+		}
+
+		allocCount.fetch_sub(count);
+	}
+
+	//TLS 캐시가 비면 여러개를 한번에 가져간다.
+	//묶음이 있으면 묶음을 통째로, 없으면 낱개로 가져가고
+	//그래도 모자란 만큼은 Slab을 새로 만들어서 채워준다.
+	void PopBatch(MemoryHeader** headers, __int32 count)
+	{
+		__int32 popped = 0;
+
+		popCount.fetch_add(1);
+		MemoryHeader* batch = nullptr;
+		if (count == BATCH_SIZE)
+			batch = static_cast<MemoryHeader*>(PopEntryList(&batchHeader));
+
+		while (batch == nullptr && popped < count)
+		{
+			MemoryHeader* memory = static_cast<MemoryHeader*>(PopEntryList(&header));
+			if (memory == nullptr)
+				break;
+
+			headers[popped++] = memory;
+		}
+		popCount.fetch_sub(1);
+
+		//떼어온 묶음은 이제 나만 가지고 있기 때문에 마음놓고 따라가도 된다.
+		for (; batch != nullptr; batch = batch->batchNext)
+			headers[popped++] = batch;
+
+		while (popped < count)
+			popped += AllocateSlab(&headers[popped], count - popped);
+
+		UpdatePeak(allocCount.fetch_add(count) + count);
+	}
+
+	/*
+		블록이 전부 풀에 돌아와 있는 Slab을 찾아서 해제한다. 해제한 Slab의 수를 리턴한다.
+		SList 중간에 있는 블록만 쏙 빼낼 수는 없기 때문에 리스트를 통째로 떼어낸 다음
+		Slab마다 몇개가 돌아와 있는지 세고, 해제하지 않을 블록들만 다시 넣어준다.
+	*/
+	__int32 Trim()
+	{
+		std::lock_guard<std::mutex> lock(slabLock);
+
+		SListEntry* list = FlushEntryList(&header);
+
+		//묶음으로 들어가 있던 블록들도 전부 낱개 리스트로 풀어서 같이 센다.
+		SListEntry* batches = FlushEntryList(&batchHeader);
+		while (batches != nullptr)
+		{
+			MemoryHeader* batch = static_cast<MemoryHeader*>(batches);
+			batches = batches->next;
+
+			while (batch != nullptr)
+			{
+				MemoryHeader* batchNext = batch->batchNext;
+				batch->next = list;
+				list = batch;
+				batch = batchNext;
+			}
+		}
+
+		if (list == nullptr)
+			return 0;
+
+		//리스트를 떼어내기 전에 header를 읽어간 Pop이 떼어낸 블록의 next를 읽고 있을 수도 있다.
+		//그 상태에서 Slab을 해제해버리면 해제된 메모리를 읽게 되니 Pop중인 스레드가 다 빠져나갈 때까지 기다린다.
+		//(14_LockFree_Stack_1의 popCount와 같은 아이디어)
+		//계속 Pop이 몰려서 기다리는게 길어지면 이번 Trim은 포기한다.
+		for (__int32 spin = 0; popCount.load() != 0; spin++)
+		{
+			if (spin == TRIM_SPIN_COUNT)
+			{
+				RestoreList(list);
+				return 0;
+			}
+			std::this_thread::yield();
+		}
+
+		for (SListEntry* entry = list; entry != nullptr; entry = entry->next)
+			SlabOf(entry)->freeCount++;
+
+		SListEntry* keepFirst = nullptr;
+		SListEntry* keepLast = nullptr;
+		for (SListEntry* entry = list; entry != nullptr; )
+		{
+			SListEntry* next = entry->next;
+			Slab* slab = SlabOf(entry);
+			if (slab->freeCount != slab->blockCount)
+			{
+				entry->next = keepFirst;
+				keepFirst = entry;
+				if (keepLast == nullptr)
+					keepLast = entry;
+			}
+			entry = next;
+		}
+
+		if (keepFirst != nullptr)
+			PushEntryListChain(&header, keepFirst, keepLast);
+
+		__int32 releaseCount = 0;
+		Slab** link = &slabs;
+		while (*link != nullptr)
+		{
+			Slab* slab = *link;
+			if (slab->freeCount == slab->blockCount)
+			{
+				*link = slab->next;
+				AlignedFree(slab);
+				releaseCount++;
+				continue;
+			}
+
+			slab->freeCount = 0;
+			link = &slab->next;
+		}
+
+		slabCount -= releaseCount;
+		return releaseCount;
+	}
+
+	__int32 GetAllocSize() const { return allocSize; }
+	__int32 GetAllocCount() const { return allocCount; }
+	__int32 GetPeakAllocCount() const { return peakAllocCount; }
+	__int32 GetSlabSize() const { return slabSize; }
+	__int32 GetSlabCount() const { return slabCount; }
+
+private:
+	//풀에서 꺼내갈 때만 불리기 때문에 (TLS 캐시 덕분에) 자주 불리지 않는다.
+	void UpdatePeak(__int32 count)
+	{
+		__int32 peak = peakAllocCount.load(std::memory_order_relaxed);
+		while (count > peak && peakAllocCount.compare_exchange_weak(peak, count, std::memory_order_relaxed) == false)
+		{
+		}
+	}
+
+	Slab* SlabOf(SListEntry* entry) const
+	{
+		return reinterpret_cast<Slab*>(reinterpret_cast<unsigned __int64>(entry) & ~static_cast<unsigned __int64>(slabSize - 1));
+	}
+
+	//Slab을 하나 만들어서 블록으로 쪼갠다.
+	//앞에서부터 count개는 headers에 바로 담아주고 남은 블록은 풀에 넣어둔다.
+	__int32 AllocateSlab(MemoryHeader** headers, __int32 count)
+	{
+		Slab* slab = static_cast<Slab*>(AlignedMalloc(slabSize, slabSize));
+		slab->blockCount = static_cast<__int32>((slabSize - sizeof(Slab)) / allocSize);
+		slab->freeCount = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(slabLock);
+			slab->next = slabs;
+			slabs = slab;
+			slabCount++;
+		}
+
+		__int8* blocks = reinterpret_cast<__int8*>(slab + 1);
+		auto blockAt = [&](__int32 index) { return reinterpret_cast<MemoryHeader*>(blocks + static_cast<__int64>(index) * allocSize); };
+
+		const __int32 takeCount = count < slab->blockCount ? count : slab->blockCount;
+		for (__int32 i = 0; i < takeCount; i++)
+			headers[i] = blockAt(i);
+
+		//남은 블록은 BATCH_SIZE개씩 묶어서 넣고, 묶고 남은 자투리는 낱개로 넣는다.
+		__int32 index = takeCount;
+		for (; index + BATCH_SIZE <= slab->blockCount; index += BATCH_SIZE)
+		{
+			for (__int32 i = index; i < index + BATCH_SIZE - 1; i++)
+				blockAt(i)->batchNext = blockAt(i + 1);
+			blockAt(index + BATCH_SIZE - 1)->batchNext = nullptr;
+
+			PushEntryList(&batchHeader, blockAt(index));
+		}
+
+		if (index < slab->blockCount)
+		{
+			for (__int32 i = index; i < slab->blockCount - 1; i++)
+				blockAt(i)->next = blockAt(i + 1);
+
+			PushEntryListChain(&header, blockAt(index), blockAt(slab->blockCount - 1));
+		}
+
+		return takeCount;
+	}
+
+	//Trim을 포기할 때 떼어낸 리스트를 그대로 다시 넣는다.
+	void RestoreList(SListEntry* list)
+	{
+		SListEntry* last = list;
+		while (last->next != nullptr)
+			last = last->next;
+
+		PushEntryListChain(&header, list, last);
+	}
+
+private:
+	/*
+		header, batchHeader는 CAS로, allocCount와 popCount는 fetch_add로 Push/Pop 할 때마다 고친다.
+		전부 한 캐시라인에 있으면 낱개 Push와 묶음 Pop처럼 서로 다른 변수를 고쳐도 캐시라인을 뺏고 뺏기니 하나씩 떨어뜨린다.
+		allocSize, slabSize는 읽기만 하기 때문에 이 변수들과 같은 캐시라인에 두지 않는다. (고칠 때마다 읽는 쪽 캐시라인까지 무효가 된다)
+	*/
+	CachePadded<SListHeader> header;			//낱개 블록
+	CachePadded<SListHeader> batchHeader;		//BATCH_SIZE개짜리 묶음
+	CachePadded<std::atomic<__int32>> allocCount = 0;
+	CachePadded<std::atomic<__int32>> popCount = 0;		//PopEntryList를 실행중인 스레드 수 (Trim에서 사용)
+
+	__int32 allocSize = 0;
+	__int32 slabSize = 0;
+	std::atomic<__int32> peakAllocCount = 0;	//allocCount의 최댓값 (통계용)
+
+	std::mutex slabLock;					//Slab을 만들거나 해제할 때만 잡는다.
+	Slab* slabs = nullptr;
+	__int32 slabCount = 0;
+};
@@ -0,0 +1,187 @@
+﻿#pragma once
+
+/*
+	Memory의 크기별 풀(SizeClass.h)이 실제 트래픽에 잘 맞는지는 숫자를 봐야 알 수 있다.
+	그래서 크기별로 몇번 할당/해제됐는지, TLS 캐시에서 바로 나갔는지(hit) 공용 풀까지 갔는지(miss),
+	요청한 바이트가 블록 크기에 비해 얼마나 되는지(낭비), 최대 몇개까지 나가 있었는지를 센다.
+
+	카운터를 전역에 두고 모든 스레드가 fetch_add를 하면 캐시라인 하나를 두고 싸우게 된다. (09_Cache 참고)
+	그래서 카운터는 스레드마다 따로 두고(MemoryCache 안에), 보고 싶을 때만 모아서 합친다.
+	MEMORY_STATS를 0으로 정의하면 카운터를 세는 코드가 전부 빠진다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#if !defined(MEMORY_STATS)
+#define MEMORY_STATS 1
+#endif
+
+/////////////////
+// StatCounter //
+/////////////////
+//쓰는 스레드는 주인 하나뿐이고 다른 스레드는 읽기만 한다.
+//쓰는 쪽이 하나라서 fetch_add(lock이 붙는 명령어)를 쓸 필요 없이 읽고 더해서 저장하면 된다.
+//atomic으로 둔 이유는 합치는 스레드가 중간에 읽어도 값이 찢어지지 않게 하기 위해서다.
+class StatCounter
+{
+public:
+	void Add(__int64 value) { counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed); }
+	void Max(__int64 value)
+	{
+		if (value > counter.load(std::memory_order_relaxed))
+			counter.store(value, std::memory_order_relaxed);
+	}
+	__int64 Get() const { return counter.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<__int64> counter = 0;
+};
+
+/////////////////////
+// SizeClassStats //
+/////////////////////
+//크기별 풀 하나의 통계 (모든 스레드를 합친 값)
+struct SizeClassStats
+{
+	__int32 blockSize = 0;			//MemoryHeader를 포함한 블록 크기
+	__int64 allocCount = 0;
+	__int64 releaseCount = 0;
+	__int64 missCount = 0;			//TLS 캐시가 비어서 공용 풀까지 간 횟수
+	__int64 spillCount = 0;			//TLS 캐시가 넘쳐서 공용 풀에 돌려준 횟수
+	__int64 allocBytes = 0;			//사용자가 요청한 바이트 (MemoryHeader 제외)
+	__int64 releaseBytes = 0;
+	__int64 peakBlockCount = 0;		//공용 풀에서 동시에 나가 있던 최대 블록 수 (TLS 캐시에 있는 것 포함)
+
+	__int64 GetHitCount() const { return allocCount - missCount; }
+	__int64 GetOutstandingBytes() const { return allocBytes - releaseBytes; }
+	__int64 GetPeakBytes() const { return peakBlockCount * blockSize; }
+
+	//블록 크기 대비 요청한 크기가 평균 얼마나 되는지 (1에 가까울수록 낭비가 적다)
+	double GetFillRatio() const { return allocCount == 0 ? 0.0 : static_cast<double>(allocBytes) / (static_cast<double>(allocCount) * blockSize); }
+};
+
+//MAX_ALLOC_SIZE보다 커서 풀을 거치지 않고 malloc으로 간 할당의 통계
+struct LargeAllocStats
+{
+	__int64 allocCount = 0;
+	__int64 releaseCount = 0;
+	__int64 allocBytes = 0;
+	__int64 releaseBytes = 0;
+	__int64 maxSize = 0;			//가장 컸던 할당 하나의 크기
+	__int64 peakBytes = 0;			//동시에 나가 있던 최대 바이트
+
+	__int64 GetOutstandingBytes() const { return allocBytes - releaseBytes; }
+};
+
+/////////////////
+// MemoryStats //
+/////////////////
+//Memory::GetStats()가 돌려주는 스냅샷. 모든 스레드의 카운터를 합친 값이다.
+struct MemoryStats
+{
+	std::vector<SizeClassStats> sizeClasses;
+	LargeAllocStats large;
+	__int32 liveThreadCount = 0;		//지금 카운터를 들고 있는 스레드 수
+	__int32 exitedThreadCount = 0;		//끝나면서 카운터를 넘겨주고 간 스레드 수
+
+	std::string ToText() const
+	{
+		std::string text;
+		Append(text, "threads live %d, exited %d\n", liveThreadCount, exitedThreadCount);
+		Append(text, "%6s %12s %12s %8s %8s %8s %14s %14s %6s\n", "block", "alloc", "release", "hit%", "miss", "spill", "outstanding", "peak bytes", "fill%");
+
+		for (const SizeClassStats& stats : sizeClasses)
+		{
+			//한번도 안쓰인 크기는 건너뛴다.
+			if (stats.allocCount == 0 && stats.peakBlockCount == 0)
+				continue;
+
+			const double hitRatio = stats.allocCount == 0 ? 0.0 : 100.0 * stats.GetHitCount() / stats.allocCount;
+			Append(text, "%6d %12lld %12lld %8.2f %8lld %8lld %14lld %14lld %6.1f\n",
+				stats.blockSize, stats.allocCount, stats.releaseCount, hitRatio, stats.missCount, stats.spillCount,
+				stats.GetOutstandingBytes(), stats.GetPeakBytes(), 100.0 * stats.GetFillRatio());
+		}
+
+		Append(text, "large  alloc %lld, release %lld, outstanding %lld, peak %lld, max size %lld\n",
+			large.allocCount, large.releaseCount, large.GetOutstandingBytes(), large.peakBytes, large.maxSize);
+
+		return text;
+	}
+
+	std::string ToJson() const
+	{
+		std::string json;
+		Append(json, "{\"liveThreadCount\":%d,\"exitedThreadCount\":%d,\"sizeClasses\":[", liveThreadCount, exitedThreadCount);
+
+		for (size_t i = 0; i < sizeClasses.size(); i++)
+		{
+			const SizeClassStats& stats = sizeClasses[i];
+			Append(json, "%s{\"blockSize\":%d,\"allocCount\":%lld,\"releaseCount\":%lld,\"hitCount\":%lld,\"missCount\":%lld,\"spillCount\":%lld,"
+				"\"allocBytes\":%lld,\"releaseBytes\":%lld,\"outstandingBytes\":%lld,\"peakBlockCount\":%lld,\"peakBytes\":%lld}",
+				i == 0 ? "" : ",", stats.blockSize, stats.allocCount, stats.releaseCount, stats.GetHitCount(), stats.missCount, stats.spillCount,
+				stats.allocBytes, stats.releaseBytes, stats.GetOutstandingBytes(), stats.peakBlockCount, stats.GetPeakBytes());
+		}
+
+		Append(json, "],\"large\":{\"allocCount\":%lld,\"releaseCount\":%lld,\"allocBytes\":%lld,\"releaseBytes\":%lld,\"outstandingBytes\":%lld,\"peakBytes\":%lld,\"maxSize\":%lld}}",
+			large.allocCount, large.releaseCount, large.allocBytes, large.releaseBytes, large.GetOutstandingBytes(), large.peakBytes, large.maxSize);
+
+		return json;
+	}
+
+private:
+	template<typename... Args>
+	static void Append(std::string& out, const char* format, Args... args)
+	{
+		char buffer[512];
+		const int length = ::snprintf(buffer, sizeof(buffer), format, args...);
+		if (length > 0)
+			out.append(buffer, length < static_cast<int>(sizeof(buffer)) ? length : sizeof(buffer) - 1);
+	}
+};
+
+//////////////////////////
+// Thread Stat Counters //
+//////////////////////////
+//스레드 하나가 크기별 풀 하나에 대해 들고 있는 카운터
+struct SizeClassCounters
+{
+	void MergeTo(SizeClassStats& stats) const
+	{
+		stats.allocCount += allocCount.Get();
+		stats.releaseCount += releaseCount.Get();
+		stats.missCount += missCount.Get();
+		stats.spillCount += spillCount.Get();
+		stats.allocBytes += allocBytes.Get();
+		stats.releaseBytes += releaseBytes.Get();
+	}
+
+	StatCounter allocCount;
+	StatCounter releaseCount;
+	StatCounter missCount;
+	StatCounter spillCount;
+	StatCounter allocBytes;
+	StatCounter releaseBytes;
+};
+
+struct LargeAllocCounters
+{
+	void MergeTo(LargeAllocStats& stats) const
+	{
+		stats.allocCount += allocCount.Get();
+		stats.releaseCount += releaseCount.Get();
+		stats.allocBytes += allocBytes.Get();
+		stats.releaseBytes += releaseBytes.Get();
+		if (maxSize.Get() > stats.maxSize)
+			stats.maxSize = maxSize.Get();
+	}
+
+	StatCounter allocCount;
+	StatCounter releaseCount;
+	StatCounter allocBytes;
+	StatCounter releaseBytes;
+	StatCounter maxSize;
+};
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+/*
+	xnew는 크기만 보고 Memory의 풀 중 하나를 고른 다음 앞에 MemoryHeader를 붙여서 돌려준다.
+	그런데 세션, 패킷, 타이머처럼 엄청 자주 만들고 지우는 타입은 크기가 컴파일 타임에 이미 정해져 있다.
+	그렇다면 타입마다 전용 풀을 하나씩 두면
+	1. 크기를 보고 풀을 찾는 과정이 필요없고
+	2. 어느 풀로 돌려보내야 하는지 적어둘 MemoryHeader도 필요없다. (타입이 곧 풀이니까)
+	블록이 풀에 돌아와 있는 동안에는 블록의 맨 앞을 SListEntry로 쓰고, 꺼내 가면 그 자리에 객체를 만든다.
+	Memory와 마찬가지로 스레드마다 Magazine을 하나씩 둬서 평소에는 공용 풀까지 가지 않는다.
+*/
+
+#include "Allocator.h"
+#include <memory>
+
+template<typename Type>
+class ObjectPool
+{
+public:
+	//블록 하나의 크기. 풀에 있는 동안 SListEntry로도 쓰이기 때문에 16바이트 단위로 올림한다.
+	static constexpr __int32 BLOCK_SIZE = static_cast<__int32>((sizeof(Type) + SLIST_ALIGNMENT - 1) & ~(SLIST_ALIGNMENT - 1));
+
+	static_assert(alignof(Type) <= SLIST_ALIGNMENT, "ObjectPool은 16바이트보다 크게 정렬된 타입은 지원하지 않는다.");
+
+	template<typename... Args>
+	static Type* Pop(Args&&... args)
+	{
+		Type* memory = static_cast<Type*>(Allocate());
+		new(memory)Type(std::forward<Args>(args)...);
+		return memory;
+	}
+
+	static void Push(Type* obj)
+	{
+		obj->~Type();
+		Release(obj);
+	}
+
+	//생성자/소멸자 없이 블록만 주고받는다. (MakeShared의 Allocator에서 사용)
+	static void* Allocate()
+	{
+		return t_cache.magazine.Pop(&s_pool);
+	}
+
+	static void Release(void* ptr)
+	{
+		t_cache.magazine.Push(&s_pool, static_cast<MemoryHeader*>(ptr));
+	}
+
+	static __int32 GetAllocCount() { return s_pool.GetAllocCount(); }
+
+private:
+	//스레드가 끝날 때 들고 있던 블록을 공용 풀에 돌려주기 위해 한번 감싼다.
+	struct LocalCache
+	{
+		~LocalCache() { magazine.Flush(); }
+
+		Magazine magazine;
+	};
+
+	static inline MemoryPool s_pool{ BLOCK_SIZE };
+	static inline thread_local LocalCache t_cache;
+};
+
+/*
+	std::make_shared는 객체와 Control Block(18_SmartPointer 참고)을 한번에 할당한다.
+	할당을 어디서 할지는 std::allocate_shared에 Allocator를 넘겨서 바꿀 수 있는데
+	표준 라이브러리는 넘겨준 Allocator를 [Control Block + 객체] 타입으로 rebind해서 딱 1개를 할당한다.
+	그러니 rebind된 타입의 ObjectPool에서 꺼내주면 객체와 Control Block이 한번에 ObjectPool에서 나오게 된다.
+*/
+template<typename Type>
+class ObjectPoolAllocator
+{
+public:
+	using value_type = Type;
+
+	ObjectPoolAllocator() {}
+	template<typename Other>
+	ObjectPoolAllocator(const ObjectPoolAllocator<Other>&) {}
+
+	Type* allocate(size_t count)
+	{
+		if (count == 1)
+			return static_cast<Type*>(ObjectPool<Type>::Allocate());
+
+		return static_cast<Type*>(PoolAllocator::Alloc(static_cast<__int32>(count * sizeof(Type))));
+	}
+
+	void deallocate(Type* ptr, size_t count)
+	{
+		if (count == 1)
+			ObjectPool<Type>::Release(ptr);
+		else
+			PoolAllocator::Release(ptr);
+	}
+
+	template<typename Other>
+	bool operator==(const ObjectPoolAllocator<Other>&) const { return true; }
+	template<typename Other>
+	bool operator!=(const ObjectPoolAllocator<Other>&) const { return false; }
+};
+
+template<typename Type, typename... Args>
+std::shared_ptr<Type> MakeShared(Args&&... args)
+{
+	return std::allocate_shared<Type>(ObjectPoolAllocator<Type>(), std::forward<Args>(args)...);
+}
@@ -0,0 +1,26 @@
+﻿#pragma once
+
+/*
+	Elimination의 칸 고르기, ThreadPool의 훔쳐올 일꾼 고르기처럼 "아무거나 하나" 고를 때 쓰는 가벼운 난수.
+	rand()는 모든 스레드가 상태 하나를 같이 쓰고, std::mt19937은 상태가 2.5KB나 된다.
+	ThreadRandom은 스레드마다 4바이트짜리 xorshift 상태를 하나씩 둔다. (암호용이 아니다)
+*/
+
+#include "Types.h"
+#include <atomic>
+
+//////////////////
+// ThreadRandom //
+//////////////////
+inline unsigned __int32 ThreadRandom()
+{
+	//스레드마다 다른 시드를 준다. 모두 같은 시드로 시작하면 모든 스레드가 같은 순서로 골라서 무작위로 고르는 의미가 없다.
+	//번호에 황금비 상수(2^32 / 1.618...)를 곱해서 비트를 고르게 섞고, xorshift는 0이면 계속 0이라 | 1로 막는다.
+	static std::atomic<unsigned __int32> GSeedCounter = 0;
+	static thread_local unsigned __int32 LRandom = ((GSeedCounter.fetch_add(1, std::memory_order_relaxed) + 1) * 2654435769u) | 1;
+
+	LRandom ^= LRandom << 13;
+	LRandom ^= LRandom >> 17;
+	LRandom ^= LRandom << 5;
+	return LRandom;
+}
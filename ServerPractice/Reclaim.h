@@ -0,0 +1,64 @@
+﻿#pragma once
+
+/*
+	lock free 자료구조가 떼어낸 노드를 언제 지울지(메모리 회수) 정하는 방법을 바꿔 끼울 수 있게 모양을 맞춰놓은 것이다.
+	LockFreeStack.h, LockFreeQueue.h가 템플릿 인자(Reclaim)로 받는다.
+
+	Reclaim은 이렇게 생겼다.
+	- Guard       : 노드를 읽는 동안 들고 있는 객체. Protect(src)로 src가 가리키는 노드를 안전하게 읽어온다.
+	- Retire(ptr) : 떼어낸 노드를 넘긴다. 안전해지면 delete 된다. (Retire(ptr, deleter)는 delete 대신 deleter를 부른다)
+
+	1. HazardReclaim : Guard가 Hazard 칸 하나. (HazardPointer.h)
+	2. EpochReclaim  : Guard가 Pin 구간. Protect는 그냥 읽기만 한다. (EpochReclamation.h)
+*/
+
+#include "HazardPointer.h"
+#include "EpochReclamation.h"
+#include <atomic>
+
+///////////////////
+// HazardReclaim //
+///////////////////
+struct HazardReclaim
+{
+	class Guard
+	{
+	public:
+		template<typename T>
+		T* Protect(const std::atomic<T*>& src) { return hazard.Protect(src); }
+
+		void Reset() { hazard.Reset(); }
+
+	private:
+		HazardPointer hazard;
+	};
+
+	template<typename T>
+	static void Retire(T* ptr) { HazardRetire(ptr); }
+
+	static void Retire(void* ptr, void (*deleter)(void*)) { HazardRetire(ptr, deleter); }
+};
+
+//////////////////
+// EpochReclaim //
+//////////////////
+struct EpochReclaim
+{
+	class Guard
+	{
+	public:
+		//Pin 되어 있는 동안은 읽은 노드가 지워지지 않기 때문에 적어둘 필요가 없다.
+		template<typename T>
+		T* Protect(const std::atomic<T*>& src) { return src.load(std::memory_order_acquire); }
+
+		void Reset() {}
+
+	private:
+		EpochGuard epoch;
+	};
+
+	template<typename T>
+	static void Retire(T* ptr) { EpochRetire(ptr); }
+
+	static void Retire(void* ptr, void (*deleter)(void*)) { EpochRetire(ptr, deleter); }
+};
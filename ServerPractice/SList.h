@@ -0,0 +1,84 @@
+﻿#pragma once
+
+/*
+	23_MemoryPool2에서 만들었던 ABA 문제를 우회하는 SList를 실제로 쓸 수 있게 헤더로 옮겼다.
+	23_MemoryPool2 버전은 InterlockedCompareExchange128이 윈도우 전용이라 리눅스에서는 빌드가 되지 않는다.
+	그래서 (맨 앞 entry, sequence)를 한번에 CAS 하는 부분을 AtomicPair.h의 AtomicTaggedPtr로 바꿨다.
+	1. DWCAS가 되는 플랫폼 : 포인터 64비트 + sequence 64비트
+	2. 안 되는 플랫폼      : 포인터 48비트 + sequence 16비트 (sequence가 금방 한바퀴 돌아서 ABA를 막는 힘은 약하다)
+	윈도우 SLIST_HEADER처럼 depth를 같이 넣지는 않는다. (2번 방식에는 넣을 자리가 없다)
+*/
+
+#include "Types.h"
+#include "AtomicPair.h"
+
+enum
+{
+	SLIST_ALIGNMENT = 16
+};
+
+//16바이트 CAS를 하는 건 SListHeader뿐이라 entry는 정렬할 필요가 없다.
+//윈도우의 SLIST_ENTRY처럼 alignas(16)을 붙이면 이걸 상속하는 MemoryHeader 뒤에 패딩이 생겨서 블록마다 16바이트를 더 쓴다.
+struct SListEntry
+{
+	SListEntry* next;
+};
+
+//tag는 Push/Pop/Flush를 할 때마다 1씩 올라가는 sequence다.
+struct alignas(SLIST_ALIGNMENT) SListHeader
+{
+	AtomicTaggedPtr<SListEntry> top;
+};
+
+inline void InitializeHead(SListHeader* header)
+{
+	header->top.Store(TaggedPtr<SListEntry>{});
+}
+
+//first부터 last까지 이미 next로 연결되어 있는 entry들을 한번에 넣는다.
+//하나씩 넣으면 CAS를 entry 수만큼 해야 하지만 이렇게 하면 한번에 끝난다.
+inline void PushEntryListChain(SListHeader* header, SListEntry* first, SListEntry* last)
+{
+	TaggedPtr<SListEntry> expected = header->top.LoadRelaxed();
+	while (true)
+	{
+		last->next = expected.ptr;
+
+		//실패하면 expected에 header의 최신 값이 들어오기 때문에 다시 읽을 필요가 없다.
+		if (header->top.CompareExchange(expected, TaggedPtr<SListEntry>{ first, expected.tag + 1 }))
+			break;
+	}
+}
+
+inline void PushEntryList(SListHeader* header, SListEntry* entry)
+{
+	PushEntryListChain(header, entry, entry);
+}
+
+inline SListEntry* PopEntryList(SListHeader* header)
+{
+	TaggedPtr<SListEntry> expected = header->top.LoadRelaxed();
+	while (expected.ptr != nullptr)
+	{
+		//23_MemoryPool2에서 얘기했던 것처럼 entry를 다른 스레드가 먼저 가져갔다면 entry->next는 엉뚱한 값일 수 있다.
+		//그래도 메모리 풀의 블록은 풀이 살아있는 동안 운영체제에 돌려주지 않기 때문에 읽는 것 자체로 터지지는 않고
+		//sequence가 바뀌어 있어서 CAS가 실패하게 된다.
+		if (header->top.CompareExchange(expected, TaggedPtr<SListEntry>{ expected.ptr->next, expected.tag + 1 }))
+			return expected.ptr;
+	}
+
+	return nullptr;
+}
+
+//리스트를 통째로 떼어낸다. 떼어낸 리스트는 next를 따라가면서 쓰면 된다.
+inline SListEntry* FlushEntryList(SListHeader* header)
+{
+	TaggedPtr<SListEntry> expected = header->top.LoadRelaxed();
+	while (expected.ptr != nullptr)
+	{
+		if (header->top.CompareExchange(expected, TaggedPtr<SListEntry>{ nullptr, expected.tag + 1 }))
+			return expected.ptr;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+/*
+	02_Atomic처럼 여러 스레드가 atomic<int> 하나를 계속 올리면 올릴 때마다 그 캐시라인을 자기 코어로 가져와야 한다.
+	다른 코어가 방금 올렸으면 그 코어의 캐시에서 뺏어와야 하니 스레드가 늘어날수록 한번 올리는 비용이 커진다. (09_Cache 참고)
+
+	ShardedCounter는 값을 SHARD_COUNT개의 칸(Cell)에 나눠서 센다.
+	1. 칸마다 캐시라인을 따로 쓰고, 스레드는 처음 쓸 때 정해진 자기 칸에만 더한다. 다른 스레드와 같은 캐시라인을 만질 일이 거의 없다.
+	   (스레드가 SHARD_COUNT보다 많으면 칸을 같이 쓰게 되니 fetch_add는 그대로 쓴다. 대신 memory_order_relaxed)
+	2. 읽을 때는 모든 칸을 더한다. 읽기는 비싸지고 쓰기는 싸진다. 통계 카운터처럼 많이 쓰고 가끔 읽는 값에 맞다.
+	   - Get       : 모든 칸을 지금 더한다. 더하는 중에 다른 스레드가 올린 값은 들어갈 수도 안 들어갈 수도 있다.
+	                 올리는 스레드가 다 끝난 뒤(join 후)에 부르면 정확한 값이다.
+	   - GetApprox : 마지막으로 Get(또는 Refresh)을 했을 때의 합을 돌려준다. 칸을 돌지 않아서 아주 싸다.
+
+	합이 0이 되는 순간을 알아야 하는 곳(RefCountable의 refCount)이나
+	fetch_add의 결과로 최댓값을 갱신하는 곳(MemoryPool의 allocCount)에는 쓸 수 없다. 합을 바로 알 수 없기 때문.
+*/
+
+#include "Types.h"
+#include <atomic>
+
+////////////////////
+// ShardedCounter //
+////////////////////
+class ShardedCounter
+{
+public:
+	enum
+	{
+		SHARD_COUNT = 64		//2의 거듭제곱
+	};
+
+	ShardedCounter() = default;
+	ShardedCounter(const ShardedCounter&) = delete;
+	ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+	void Add(__int64 value) { cells[GetShardIndex()].value.fetch_add(value, std::memory_order_relaxed); }
+	void Increment() { Add(1); }
+	void Decrement() { Add(-1); }
+
+	__int64 Get()
+	{
+		__int64 sum = 0;
+		for (const Cell& cell : cells)
+			sum += cell.value.load(std::memory_order_relaxed);
+
+		approxSum.store(sum, std::memory_order_relaxed);
+		return sum;
+	}
+
+	__int64 GetApprox() const { return approxSum.load(std::memory_order_relaxed); }
+
+	//GetApprox가 돌려줄 값을 새로 계산해둔다. (타이머 등에서 주기적으로 부른다)
+	void Refresh() { Get(); }
+
+private:
+	//스레드마다 처음 쓸 때 한번 정해서 계속 쓴다. 모든 ShardedCounter가 같은 번호를 쓴다.
+	static __int32 GetShardIndex()
+	{
+		static thread_local __int32 LShardIndex = GNextShardIndex.fetch_add(1, std::memory_order_relaxed) & (SHARD_COUNT - 1);
+		return LShardIndex;
+	}
+
+	struct alignas(CACHE_LINE_SIZE) Cell
+	{
+		std::atomic<__int64> value = 0;
+	};
+
+private:
+	Cell cells[SHARD_COUNT];
+
+	//읽는 쪽만 쓰는 값이라 칸들과 캐시라인을 따로 쓴다.
+	alignas(CACHE_LINE_SIZE) std::atomic<__int64> approxSum = 0;
+
+	static inline std::atomic<__int32> GNextShardIndex = 0;
+};
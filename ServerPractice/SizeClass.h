@@ -0,0 +1,99 @@
+﻿#pragma once
+
+/*
+	Memory는 요청 크기를 어느 풀로 보낼지 [0 ~ MAX_ALLOC_SIZE] 크기의 표에서 찾았다.
+	표가 4KB나 되다 보니 여러 크기가 섞여서 들어오면 표를 읽는 것만으로 L1 캐시를 꽤 차지하게 된다.
+	그리고 32/128/256 단위는 손으로 정한 값이라 작은 크기에서는 낭비가 크고 큰 크기에서는 풀이 너무 촘촘했다.
+
+	그래서 jemalloc처럼 크기 구간을 2배씩 나누고, 구간마다 똑같은 개수(STEP_COUNT)로 쪼갠다.
+	(16)  32  48  64 | 80  96  112  128 | 160  192  224  256 | 320 ... 512 | ... | 2560  3072  3584  4096
+	이렇게 하면 어느 크기든 낭비가 한 구간의 1/STEP_COUNT를 넘지 않는다.
+	그리고 크기 -> 번호는 표 없이 countl_zero(앞에서부터 0인 비트 수)와 시프트 몇번으로 바로 계산된다.
+
+	Memory는 요청 크기에 MemoryHeader(16바이트)를 더해서 풀을 찾기 때문에 16바이트 이하의 블록은 쓰일 일이 없다.
+	그래서 맨 앞 SKIP_COUNT개 구간은 건너뛰고 32부터 번호 0을 붙인다. (Memory.h에서 static_assert로 확인한다)
+*/
+
+#include "Types.h"
+#include <bit>
+#include <algorithm>
+
+///////////////
+// SizeClass //
+///////////////
+class SizeClass
+{
+public:
+	enum
+	{
+		LG_QUANTUM = 4,		//가장 작은 간격 (16바이트, SList가 16바이트 정렬을 요구하기 때문에 더 작게 할 수 없다)
+		LG_STEPS = 2,		//2배 구간 하나를 몇개로 쪼갤지 (2^2 = 4개). 올리면 풀이 촘촘해지고 낭비가 줄어든다.
+		LG_MAX_SIZE = 12,	//풀이 담당하는 최대 크기 (2^12 = 4096)
+
+		QUANTUM = 1 << LG_QUANTUM,
+		STEP_COUNT = 1 << LG_STEPS,
+		MAX_SIZE = 1 << LG_MAX_SIZE,
+
+		//MemoryHeader보다 작거나 같아서 쓰이지 않는 맨 앞 구간 수 (16)
+		SKIP_COUNT = 1,
+
+		//처음 STEP_COUNT개는 QUANTUM 간격으로 늘어나고 그 다음부터는 2배 구간마다 STEP_COUNT개씩. 여기서 건너뛴 구간을 뺀다.
+		COUNT = ((LG_MAX_SIZE - LG_QUANTUM - LG_STEPS + 1) << LG_STEPS) - SKIP_COUNT,
+
+		//번호 0의 크기. 이보다 작은 크기도 전부 번호 0이다.
+		MIN_SIZE = (SKIP_COUNT + 1) << LG_QUANTUM
+	};
+
+	/*
+		size(1 ~ MAX_SIZE)를 담을 수 있는 가장 작은 크기 번호
+		size가 (2^(k-1), 2^k] 구간에 있으면 그 구간의 간격은 2^(k - LG_STEPS - 1)이고 (처음 구간은 QUANTUM)
+		(size - 1)을 간격으로 나누면 [STEP_COUNT, 2 * STEP_COUNT) 사이의 값이 나온다.
+		여기에 앞 구간들의 번호를 더해주면 끝이다. 분기 없이 countl_zero 한번과 시프트 몇번이면 된다.
+		건너뛴 구간에 들어가는 작은 크기는 max로 번호 0에 붙인다.
+	*/
+	static constexpr __int32 ToIndex(__int32 size)
+	{
+		//k = ceil(log2(size)) = 32 - countl_zero(size - 1)
+		//| 1은 size가 1일 때 countl_zero(0)이 되는 것을 막는다. (0이 아니라는 걸 알면 컴파일러가 분기 없는 명령어 하나로 만든다)
+		//size가 1이면 k가 0 대신 1이 되지만 어차피 처음 구간이라 결과는 같다.
+		const __int32 lgCeil = 32 - std::countl_zero(static_cast<unsigned __int32>(size - 1) | 1);
+
+		//간격(2^lgDelta). 처음 구간들은 QUANTUM보다 작아지지 않게 막는다.
+		const __int32 lgDelta = std::max<__int32>(lgCeil - LG_STEPS - 1, LG_QUANTUM);
+
+		return std::max<__int32>(((lgDelta - LG_QUANTUM) << LG_STEPS) + ((size - 1) >> lgDelta) - SKIP_COUNT, 0);
+	}
+
+	//번호에 해당하는 블록 크기
+	static constexpr __int32 ToSize(__int32 index)
+	{
+		index += SKIP_COUNT;
+		const __int32 group = index >> LG_STEPS;
+		const __int32 step = index & (STEP_COUNT - 1);
+		if (group == 0)
+			return (step + 1) << LG_QUANTUM;
+
+		const __int32 base = 1 << (group + LG_STEPS + LG_QUANTUM - 1);
+		return base + (step + 1) * (base >> LG_STEPS);
+	}
+
+	//모든 크기에 대해 ToIndex와 ToSize가 서로 맞는지 컴파일 타임에 확인한다.
+	static constexpr bool Verify()
+	{
+		if (ToSize(0) != MIN_SIZE || ToIndex(1) != 0 || ToSize(COUNT - 1) != MAX_SIZE)
+			return false;
+
+		for (__int32 index = 0; index < COUNT; index++)
+		{
+			const __int32 size = ToSize(index);
+			if (size % QUANTUM != 0 || ToIndex(size) != index)
+				return false;
+			if (index > 0 && ToIndex(ToSize(index - 1) + 1) != index)
+				return false;
+		}
+		return true;
+	}
+};
+
+static_assert(SizeClass::LG_STEPS <= SizeClass::LG_MAX_SIZE - SizeClass::LG_QUANTUM, "LG_STEPS가 너무 크다.");
+static_assert(SizeClass::Verify(), "크기 표가 잘못 만들어졌다.");
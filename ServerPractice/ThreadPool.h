@@ -0,0 +1,300 @@
+﻿#pragma once
+
+/*
+	지금까지 예제들은 일이 생길 때마다 std::thread를 직접 만들거나(01_ThreadStart, 12_TLS)
+	std::async(08_Future)를 썼는데 std::async(launch::async)도 일 하나에 스레드 하나를 새로 만든다.
+	스레드를 만들고 없애는 건 일 자체보다 훨씬 비쌀 때가 많다.
+
+	ThreadPool은 처음에 일꾼(worker) 스레드를 정해진 수만큼 만들어두고 일을 나눠준다.
+	1. 일꾼마다 WorkStealingDeque(Chase-Lev 덱)를 하나씩 가진다.
+	   일꾼이 일을 하다가 새 일을 Submit하면 자기 덱에 넣는다. (CAS 없이 배열에 쓰고 bottom만 옮긴다)
+	2. 일꾼이 아닌 스레드(main 등)가 Submit하면 모두가 같이 보는 주입 큐(LockFreeQueue)에 넣는다.
+	3. 일꾼은 자기 덱 -> 주입 큐 -> 다른 일꾼의 덱(무작위로 골라서 훔치기) 순서로 일을 찾는다.
+	4. 그래도 없으면 잠든다. 잠드는 방법은 MPMCQueue::Wait/Notify와 같다. (대기 수 + signal에 atomic::wait)
+	   깨우는 쪽은 대기 수를 읽기만 하고 0이면 아무것도 안 하기 때문에 다들 바쁠 때는 Submit이 공유 변수에 쓰지 않는다.
+
+	ParallelFor는 범위를 반씩 쪼개서 뒤쪽 절반을 Submit하고 앞쪽 절반을 계속 쪼개는 식으로 나눈다.
+	쪼갠 일은 일꾼의 덱에 들어가니 놀고 있는 일꾼이 큰 덩어리부터 훔쳐간다.
+	기다리는 스레드도 놀지 않고 일을 찾아서 같이 한다. (일꾼 안에서 ParallelFor를 불러도 막히지 않는다)
+
+	일이 던진 예외가 일꾼 스레드 밖으로 나가면 std::terminate로 프로세스가 끝난다.
+	Submit한 일의 예외는 삼키고 GetFailedCount로 세기만 한다. (Future는 Then에서 잡아서 다음 Future로 넘긴다)
+	ParallelFor는 조각이 던진 예외 중 첫번째를 모아뒀다가 전부 끝난 뒤 부른 쪽에서 다시 던진다.
+*/
+
+#include "Types.h"
+#include "WorkStealingDeque.h"
+#include "LockFreeQueue.h"
+#include "ObjectPool.h"
+#include "Random.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+////////////////
+// ThreadPool //
+////////////////
+class ThreadPool
+{
+	struct Task
+	{
+		Task(std::function<void()>&& func) : func(std::move(func)) {}
+
+		std::function<void()> func;
+	};
+
+	//ParallelFor 하나가 조각들과 같이 보는 것들. 부른 쪽의 스택에 있다.
+	struct ForContext
+	{
+		std::atomic<__int64> pending = 1;
+		std::atomic<bool> failed = false;
+		std::exception_ptr error;
+	};
+
+	//일꾼마다 따로 쓰는 것들. 다른 일꾼이 훔치러 오기 때문에 캐시라인을 나눈다.
+	struct alignas(CACHE_LINE_SIZE) Worker
+	{
+		WorkStealingDeque<Task*> deque;
+		std::thread thread;
+	};
+
+public:
+	enum
+	{
+		SPIN_COUNT = 64		//잠들기 전에 일을 다시 찾아보는 횟수
+	};
+
+	//workerCount가 0이면 코어 수만큼 만든다.
+	explicit ThreadPool(__int32 workerCount = 0)
+	{
+		if (workerCount <= 0)
+			workerCount = static_cast<__int32>(std::thread::hardware_concurrency());
+		if (workerCount <= 0)
+			workerCount = 1;
+
+		workers.reserve(workerCount);
+		for (__int32 i = 0; i < workerCount; i++)
+			workers.push_back(std::make_unique<Worker>());
+
+		for (__int32 i = 0; i < workerCount; i++)
+			workers[i]->thread = std::thread([this, i]() { WorkerLoop(i); });
+	}
+
+	//남아있는 일은 전부 처리하고 끝난다.
+	~ThreadPool()
+	{
+		stop.store(true, std::memory_order_seq_cst);
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		signal.notify_all();
+
+		for (std::unique_ptr<Worker>& worker : workers)
+			worker->thread.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	template<typename Func>
+	void Submit(Func&& func)
+	{
+		Task* task = ObjectPool<Task>::Pop(std::function<void()>(std::forward<Func>(func)));
+
+		if (LPool == this)
+			workers[LWorkerIndex]->deque.Push(task);
+		else
+			injection.Push(task);
+
+		Notify();
+	}
+
+	/*
+		[begin, end)를 grain 이하의 조각으로 나눠서 func(first, last)를 부른다. 전부 끝날 때까지 돌아오지 않는다.
+		func는 기다리는 동안 살아있기 때문에 참조로 넘겨도 된다. 조각이 예외를 던져도 나머지는 끝까지 하고 첫번째 예외를 다시 던진다.
+	*/
+	template<typename Func>
+	void ParallelFor(__int64 begin, __int64 end, __int64 grain, const Func& func)
+	{
+		if (begin >= end)
+			return;
+		if (grain < 1)
+			grain = 1;
+
+		ForContext context;
+		Split(begin, end, grain, func, context);
+
+		while (context.pending.load(std::memory_order_acquire) != 0)
+		{
+			if (RunOne() == false)
+				std::this_thread::yield();
+		}
+
+		if (context.error)
+			std::rethrow_exception(context.error);
+	}
+
+	//일을 하나 찾아서 처리한다. 찾지 못했으면 false (기다리는 동안 같이 일을 할 때 쓴다)
+	bool RunOne()
+	{
+		Task* task = FindTask();
+		if (task == nullptr)
+			return false;
+
+		Run(task);
+		return true;
+	}
+
+	__int32 GetWorkerCount() const { return static_cast<__int32>(workers.size()); }
+
+	//예외를 던지고 끝난 일의 수
+	__int64 GetFailedCount() const { return failedCount.load(std::memory_order_relaxed); }
+
+	//지금 스레드가 일꾼으로 있는 풀. 일꾼이 아니면 nullptr
+	static ThreadPool* GetCurrent() { return LPool; }
+
+private:
+	template<typename Func>
+	void Split(__int64 begin, __int64 end, __int64 grain, const Func& func, ForContext& context)
+	{
+		//뒤쪽 절반을 넘기고 앞쪽을 계속 쪼갠다. 먼저 넘긴 쪽이 크기 때문에 훔쳐가는 쪽은 큰 덩어리를 가져간다.
+		while (end - begin > grain)
+		{
+			const __int64 middle = begin + (end - begin) / 2;
+			context.pending.fetch_add(1, std::memory_order_relaxed);
+			Submit([this, middle, end, grain, &func, &context]() { Split(middle, end, grain, func, context); });
+			end = middle;
+		}
+
+		//던져도 pending은 줄여야 ParallelFor가 영영 기다리지 않는다. error는 아래 release로 부른 쪽에 보인다.
+		try
+		{
+			func(begin, end);
+		}
+		catch (...)
+		{
+			if (context.failed.exchange(true, std::memory_order_relaxed) == false)
+				context.error = std::current_exception();
+		}
+		context.pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void WorkerLoop(__int32 index)
+	{
+		LPool = this;
+		LWorkerIndex = index;
+
+		while (true)
+		{
+			if (RunOne())
+				continue;
+
+			bool found = false;
+			for (__int32 spin = 0; spin < SPIN_COUNT && found == false; spin++)
+			{
+				std::this_thread::yield();
+				found = RunOne();
+			}
+			if (found)
+				continue;
+
+			if (stop.load(std::memory_order_acquire))
+			{
+				//멈추라고 했어도 남은 일은 다 한다.
+				if (RunOne())
+					continue;
+				break;
+			}
+
+			Wait();
+		}
+
+		LPool = nullptr;
+		LWorkerIndex = -1;
+	}
+
+	//내 덱 -> 주입 큐 -> 다른 일꾼의 덱 순서로 찾는다.
+	Task* FindTask()
+	{
+		Task* task = nullptr;
+		if (LPool == this && workers[LWorkerIndex]->deque.Pop(task))
+			return task;
+
+		if (injection.TryPop(task))
+			return task;
+
+		return Steal();
+	}
+
+	//무작위로 시작해서 한바퀴 돈다. 모두가 같은 일꾼부터 훔치러 가면 그 덱의 top에서 CAS 경합이 생긴다.
+	Task* Steal()
+	{
+		const __int32 count = static_cast<__int32>(workers.size());
+		const __int32 self = LPool == this ? LWorkerIndex : -1;
+		const __int32 start = static_cast<__int32>(ThreadRandom() % static_cast<unsigned __int32>(count));
+
+		Task* task = nullptr;
+		for (__int32 i = 0; i < count; i++)
+		{
+			const __int32 victim = (start + i) % count;
+			if (victim != self && workers[victim]->deque.Steal(task))
+				return task;
+		}
+		return nullptr;
+	}
+
+	void Run(Task* task)
+	{
+		try
+		{
+			task->func();
+		}
+		catch (...)
+		{
+			failedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+		ObjectPool<Task>::Push(task);
+	}
+
+	//MPMCQueue::Wait와 같다. 대기 수를 올리고 나서 다시 찾아봐야 Submit과 엇갈려도 깨우는 걸 놓치지 않는다.
+	void Wait()
+	{
+		waitCount.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const unsigned __int32 old = signal.load(std::memory_order_seq_cst);
+
+		Task* task = FindTask();
+		if (task == nullptr && stop.load(std::memory_order_acquire) == false)
+			signal.wait(old, std::memory_order_seq_cst);
+		waitCount.fetch_sub(1, std::memory_order_relaxed);
+
+		if (task != nullptr)
+			Run(task);
+	}
+
+	//잠든 일꾼이 없으면 읽기만 하고 끝난다.
+	void Notify()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waitCount.load(std::memory_order_relaxed) == 0)
+			return;
+
+		signal.fetch_add(1, std::memory_order_seq_cst);
+		signal.notify_one();
+	}
+
+private:
+	std::vector<std::unique_ptr<Worker>> workers;
+	LockFreeQueue<Task*> injection;
+
+	alignas(CACHE_LINE_SIZE) std::atomic<__int32> waitCount = 0;
+	std::atomic<unsigned __int32> signal = 0;
+	std::atomic<bool> stop = false;
+	std::atomic<__int64> failedCount = 0;
+
+	//지금 스레드가 어느 풀의 몇번 일꾼인지. 일꾼이 아니면 nullptr, -1 (L은 Local)
+	static inline thread_local ThreadPool* LPool = nullptr;
+	static inline thread_local __int32 LWorkerIndex = -1;
+};
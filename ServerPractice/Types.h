@@ -0,0 +1,33 @@
+﻿#pragma once
+
+/*
+	지금까지는 __int32, __int64 같은 MSVC 전용 타입을 그냥 썼다.
+	그런데 서버는 윈도우에서만 돌아간다는 보장이 없다. (리눅스 서버도 많다)
+	gcc/clang에는 이런 타입이 없기 때문에 MSVC가 아닐 때만 똑같은 이름으로 맞춰준다.
+	typedef가 아니라 매크로를 쓰는 이유는 unsigned __int64 처럼 앞에 unsigned가 붙는 경우가 있기 때문이다.
+*/
+#if !defined(_MSC_VER)
+#define __int8 char
+#define __int16 short
+#define __int32 int
+#define __int64 long long
+#endif
+
+//캐시는 메모리를 이 크기(캐시라인) 단위로 가져온다. (09_Cache 참고)
+//서로 다른 스레드가 자주 쓰는 변수는 같은 캐시라인에 있지 않게 이 크기로 떨어뜨려 놓는다.
+#define CACHE_LINE_SIZE 64
+
+//일부러 잘못된 주소에 써서 프로그램을 터뜨린다. 디버거가 붙어있으면 그 자리에서 멈춘다.
+#define CRASH(cause)									\
+{														\
+	volatile unsigned __int32* crash = nullptr;			\
+	*crash = 0xDEADBEEF;								\
+}
+
+#define ASSERT_CRASH(expr)								\
+{														\
+	if (!(expr))										\
+	{													\
+		CRASH("ASSERT_CRASH");							\
+	}													\
+}
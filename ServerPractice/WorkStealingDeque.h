@@ -0,0 +1,150 @@
+﻿#pragma once
+
+/*
+	Chase-Lev 작업 훔치기(work stealing) 덱.
+	스레드 풀의 일꾼(worker)마다 하나씩 가지고 있는 작업 목록이다.
+	1. 주인 스레드는 아래쪽(bottom)에서만 넣고(Push) 뺀다(Pop). 가장 최근에 넣은 일을 먼저 하니 캐시에 남아있을 확률이 높다.
+	2. 할 일이 없는 다른 일꾼은 위쪽(top)에서 훔쳐간다(Steal). 가장 오래된 일(대체로 덩어리가 큰 일)을 가져간다.
+	3. 주인의 Push는 CAS가 없다. 배열에 쓰고 bottom만 옮긴다.
+	   Pop도 남은 게 하나뿐이라 훔치려는 스레드와 겹칠 수 있을 때만 top에 CAS를 한다.
+	   그래서 일꾼이 자기가 만든 일을 자기가 처리하는 동안에는 다른 스레드와 캐시라인을 두고 싸울 일이 거의 없다.
+
+	배열이 꽉 차면 두배로 늘린다. 이전 배열은 Steal 중인 스레드가 아직 읽고 있을 수 있어서 덱이 사라질 때 같이 지운다.
+	(늘어날 때마다 두배라서 이전 배열들을 다 합쳐도 지금 배열보다 작다)
+	메모리 순서는 Lê, Pop, Cohen, Zappa Nardelli의 "Correct and Efficient Work-Stealing for Weak Memory Models"를 따랐다.
+
+	T는 포인터처럼 복사가 싸고 atomic으로 다룰 수 있는 타입이어야 한다.
+*/
+
+#include "Types.h"
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+template<typename T>
+class WorkStealingDeque
+{
+	static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque에는 포인터처럼 복사가 싼 값만 넣는다.");
+
+	struct Array
+	{
+		Array(__int64 capacity) : capacity(capacity), mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+		~Array() { delete[] slots; }
+
+		T Get(__int64 index) const { return slots[index & mask].load(std::memory_order_relaxed); }
+		void Put(__int64 index, T value) { slots[index & mask].store(value, std::memory_order_relaxed); }
+
+		const __int64 capacity;
+		const __int64 mask;
+		std::atomic<T>* slots;
+	};
+
+public:
+	enum
+	{
+		INITIAL_CAPACITY = 256		//2의 거듭제곱
+	};
+
+	WorkStealingDeque() : array(new Array(INITIAL_CAPACITY)) {}
+	WorkStealingDeque(const WorkStealingDeque&) = delete;
+	WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+	~WorkStealingDeque()
+	{
+		delete array.load(std::memory_order_relaxed);
+		for (Array* old : retired)
+			delete old;
+	}
+
+	//주인 스레드만 부른다.
+	void Push(T value)
+	{
+		const __int64 b = bottom.load(std::memory_order_relaxed);
+		const __int64 t = top.load(std::memory_order_acquire);
+		Array* a = array.load(std::memory_order_relaxed);
+		if (b - t > a->capacity - 1)
+			a = Grow(a, t, b);
+
+		a->Put(b, value);
+
+		//값을 쓴 게 bottom보다 먼저 보여야 훔치는 쪽이 빈 칸을 읽지 않는다.
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	//주인 스레드만 부른다. 가장 최근에 넣은 것을 꺼낸다.
+	bool Pop(T& value)
+	{
+		const __int64 b = bottom.load(std::memory_order_relaxed) - 1;
+		Array* a = array.load(std::memory_order_relaxed);
+
+		//bottom을 먼저 줄여서 자리를 맡아두고 top을 본다. 훔치는 쪽은 반대로 top을 보고 bottom을 본다.
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		__int64 t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			//비어있었다.
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		value = a->Get(b);
+		if (t < b)
+			return true;
+
+		//마지막 하나는 훔치려는 스레드와 겹칠 수 있어서 top을 CAS로 가져온다.
+		const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	//다른 스레드가 부른다. 가장 오래된 것을 가져간다. 비어있거나 다른 스레드에게 졌으면 false
+	bool Steal(T& value)
+	{
+		__int64 t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const __int64 b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return false;
+
+		//CAS 전에 읽어둬야 한다. 이기고 나면 그 칸은 주인이 바로 덮어쓸 수 있다.
+		Array* a = array.load(std::memory_order_acquire);
+		T stolen = a->Get(t);
+		if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+			return false;
+
+		value = stolen;
+		return true;
+	}
+
+	//다른 스레드가 넣고 빼는 중이면 부르는 순간 이미 바뀌어 있을 수 있다. (참고용)
+	__int64 GetSize() const
+	{
+		const __int64 b = bottom.load(std::memory_order_relaxed);
+		const __int64 t = top.load(std::memory_order_relaxed);
+		return b > t ? b - t : 0;
+	}
+
+private:
+	Array* Grow(Array* old, __int64 t, __int64 b)
+	{
+		Array* bigger = new Array(old->capacity * 2);
+		for (__int64 i = t; i < b; i++)
+			bigger->Put(i, old->Get(i));
+
+		retired.push_back(old);
+		array.store(bigger, std::memory_order_release);
+		return bigger;
+	}
+
+private:
+	//top은 훔치는 스레드들이, bottom은 주인이 주로 쓴다. 서로의 캐시라인을 건드리지 않게 떨어뜨린다.
+	alignas(CACHE_LINE_SIZE) std::atomic<__int64> top = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<__int64> bottom = 0;
+	alignas(CACHE_LINE_SIZE) std::atomic<Array*> array = nullptr;
+
+	//주인만 만진다.
+	std::vector<Array*> retired;
+};